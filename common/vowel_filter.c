@@ -0,0 +1,188 @@
+#include "vowel_filter.h"
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VOWEL_FILTER_X86 1
+#endif
+
+typedef size_t (*filter_fn)(char* buf, size_t len);
+
+static uint8_t keep_table[256];         // 1 - байт остаётся (не гласная)
+static uint8_t shuffle_table[256][8];   // Маска 8 сохраняемых байтов -> их индексы подряд
+
+static filter_fn current_filter;
+static const char* current_name;
+
+static int is_vowel(unsigned char c) {
+    char lower_c = tolower(c);
+    return lower_c == 'a' || lower_c == 'e' || lower_c == 'i' || lower_c == 'o' || lower_c == 'u' || lower_c == 'y';
+}
+
+// Исходная реализация из lab1/lab3: tolower и шесть сравнений на байт
+static size_t filter_reference(char* buf, size_t len) {
+    size_t write_idx = 0;
+    for (size_t read_idx = 0; read_idx < len; read_idx++) {
+        if (!is_vowel((unsigned char) buf[read_idx])) {
+            buf[write_idx++] = buf[read_idx];
+        }
+    }
+    return write_idx;
+}
+
+// Байт записывается всегда, а позиция записи сдвигается на keep_table[c]:
+// нет ветвлений, которые предсказатель угадывает плохо на обычном тексте
+static size_t filter_tail(char* buf, size_t write_idx, size_t read_idx, size_t len) {
+    for (; read_idx < len; read_idx++) {
+        unsigned char c = (unsigned char) buf[read_idx];
+        buf[write_idx] = (char) c;
+        write_idx += keep_table[c];
+    }
+    return write_idx;
+}
+
+static size_t filter_table(char* buf, size_t len) {
+    return filter_tail(buf, 0, 0, len);
+}
+
+#ifdef VOWEL_FILTER_X86
+// Уплотнение 16 байт по маске keep: каждая половина переставляется
+// по таблице и записывается 8 байтами. Запись идёт не дальше конца
+// текущих 16 байт исходного буфера, которые уже прочитаны в регистр.
+__attribute__((target("sse4.2,popcnt")))
+static inline size_t compact16(char* out, __m128i x, unsigned keep) {
+    unsigned lo = keep & 0xff;
+    unsigned hi = keep >> 8;
+    uint64_t lo_idx, hi_idx;
+    memcpy(&lo_idx, shuffle_table[lo], 8);
+    memcpy(&hi_idx, shuffle_table[hi], 8);
+    hi_idx += 0x0808080808080808ull;    // Индексы старшей половины
+    __m128i packed = _mm_shuffle_epi8(x, _mm_set_epi64x((long long) hi_idx, (long long) lo_idx));
+    size_t lo_count = (size_t) __builtin_popcount(lo);
+    _mm_storel_epi64((__m128i*) out, packed);
+    _mm_storel_epi64((__m128i*) (out + lo_count), _mm_unpackhi_epi64(packed, packed));
+    return lo_count + (size_t) __builtin_popcount(hi);
+}
+
+// 'A' | 0x20 == 'a': после OR с 0x20 гласные обоих регистров дают строчную букву,
+// и никакой другой байт в неё не переходит
+__attribute__((target("sse4.2,popcnt")))
+static size_t filter_sse4(char* buf, size_t len) {
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    size_t write_idx = 0, read_idx = 0;
+    for (; read_idx + 16 <= len; read_idx += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*) (buf + read_idx));
+        __m128i lower = _mm_or_si128(x, case_bit);
+        __m128i vowels = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('a')), _mm_cmpeq_epi8(lower, _mm_set1_epi8('e'))),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('i')), _mm_cmpeq_epi8(lower, _mm_set1_epi8('o'))),
+                         _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('u')), _mm_cmpeq_epi8(lower, _mm_set1_epi8('y')))));
+        unsigned keep = ~(unsigned) _mm_movemask_epi8(vowels) & 0xffff;
+        if (keep == 0xffff) {
+            if (write_idx != read_idx) _mm_storeu_si128((__m128i*) (buf + write_idx), x);
+            write_idx += 16;
+        } else {
+            write_idx += compact16(buf + write_idx, x, keep);
+        }
+    }
+    return filter_tail(buf, write_idx, read_idx, len);
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t filter_avx2(char* buf, size_t len) {
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    size_t write_idx = 0, read_idx = 0;
+    for (; read_idx + 32 <= len; read_idx += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*) (buf + read_idx));
+        __m256i lower = _mm256_or_si256(x, case_bit);
+        __m256i vowels = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('a')),
+                            _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('e'))),
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('i')),
+                                            _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('o'))),
+                            _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('u')),
+                                            _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('y')))));
+        uint32_t keep = ~(uint32_t) _mm256_movemask_epi8(vowels);
+        if (keep == 0xffffffffu) {
+            if (write_idx != read_idx) _mm256_storeu_si256((__m256i*) (buf + write_idx), x);
+            write_idx += 32;
+        } else {
+            write_idx += compact16(buf + write_idx, _mm256_castsi256_si128(x), keep & 0xffff);
+            write_idx += compact16(buf + write_idx, _mm256_extracti128_si256(x, 1), keep >> 16);
+        }
+    }
+    return filter_tail(buf, write_idx, read_idx, len);
+}
+#endif
+
+static const struct {
+    const char* name;
+    filter_fn fn;
+} impls[] = {
+#ifdef VOWEL_FILTER_X86
+    { "avx2", filter_avx2 },
+    { "sse4", filter_sse4 },
+#endif
+    { "table", filter_table },
+    { "reference", filter_reference },
+};
+
+static int impl_supported(filter_fn fn) {
+#ifdef VOWEL_FILTER_X86
+    if (fn == filter_avx2) return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+    if (fn == filter_sse4) return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+#endif
+    (void) fn;
+    return 1;
+}
+
+// Таблицы строятся до main: фильтр можно вызывать из любого потока без блокировок
+__attribute__((constructor))
+static void vowel_filter_init(void) {
+    for (int c = 0; c < 256; c++) {
+        keep_table[c] = !is_vowel((unsigned char) c);
+    }
+    for (int mask = 0; mask < 256; mask++) {
+        int count = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            if (mask & (1 << bit)) shuffle_table[mask][count++] = (uint8_t) bit;
+        }
+        while (count < 8) shuffle_table[mask][count++] = 0;
+    }
+#ifdef VOWEL_FILTER_X86
+    __builtin_cpu_init();
+#endif
+    // Первая поддерживаемая реализация в порядке убывания скорости
+    for (size_t i = 0; i < sizeof(impls) / sizeof(impls[0]); i++) {
+        if (impl_supported(impls[i].fn)) {
+            current_filter = impls[i].fn;
+            current_name = impls[i].name;
+            break;
+        }
+    }
+}
+
+size_t vowel_filter(char* buf, size_t len) {
+    if (!buf) {
+        return 0;
+    }
+    return current_filter(buf, len);
+}
+
+int vowel_filter_select(const char* name) {
+    for (size_t i = 0; i < sizeof(impls) / sizeof(impls[0]); i++) {
+        if (strcmp(impls[i].name, name) == 0) {
+            if (!impl_supported(impls[i].fn)) return -1;
+            current_filter = impls[i].fn;
+            current_name = impls[i].name;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char* vowel_filter_name(void) {
+    return current_name;
+}
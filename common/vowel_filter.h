@@ -0,0 +1,24 @@
+#ifndef VOWEL_FILTER_H
+#define VOWEL_FILTER_H
+
+#include <stddef.h>
+
+// Удаление гласных (a, e, i, o, u, y в любом регистре) - общий фильтр lab1 и lab3.
+// Байт за байтом, без состояния: блок можно резать где угодно.
+// Реализация выбирается при запуске программы по возможностям процессора:
+//   avx2  - классификация 32 байт за раз, уплотнение таблицей перестановок;
+//   sse4  - то же по 16 байт;
+//   table - таблица на 256 байт без ветвлений;
+//   reference - исходный вариант с tolower (для сравнения).
+
+// Удаляет гласные из buf на месте, возвращает новую длину
+size_t vowel_filter(char* buf, size_t len);
+
+// Принудительный выбор реализации по имени. Возвращает -1, если имя
+// неизвестно или процессор её не поддерживает.
+int vowel_filter_select(const char* name);
+
+// Имя реализации, которой пользуется vowel_filter
+const char* vowel_filter_name(void);
+
+#endif
@@ -0,0 +1,83 @@
+// Микробенчмарк фильтра гласных: все реализации на одном тексте.
+// Сборка и запуск:
+//   gcc -O2 -o vowel_filter_bench vowel_filter_bench.c vowel_filter.c
+//   ./vowel_filter_bench [size_mb] [repeats]
+#include "vowel_filter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char* impl_names[] = { "reference", "table", "sse4", "avx2" };
+
+// Псевдослучайный текст из слов и строк разной длины, похожий на ввод лабораторных
+static void fill_text(char* text, size_t len) {
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    unsigned long long state = 88172645463325252ull;
+    for (size_t i = 0; i < len; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        unsigned r = (unsigned) (state % 64);
+        if (r == 0) {
+            text[i] = '\n';
+        } else if (r < 9) {
+            text[i] = ' ';
+        } else {
+            text[i] = letters[(state >> 8) % (sizeof(letters) - 1)];
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t size = (argc > 1 ? strtoull(argv[1], NULL, 10) : 64) * 1024 * 1024;
+    int repeats = argc > 2 ? atoi(argv[2]) : 10;
+    if (size == 0 || repeats <= 0) {
+        fprintf(stderr, "Использование: %s [size_mb] [repeats]\n", argv[0]);
+        return 1;
+    }
+
+    char* source = malloc(size);
+    char* work = malloc(size);
+    char* expected = malloc(size);
+    if (!source || !work || !expected) {
+        perror("malloc");
+        return 1;
+    }
+    fill_text(source, size);
+
+    const char* best = vowel_filter_name();
+    vowel_filter_select("reference");
+    memcpy(expected, source, size);
+    size_t expected_len = vowel_filter(expected, size);
+
+    printf("Text: %zu bytes, %zu kept, %d repeats, default: %s\n", size, expected_len, repeats, best);
+    double reference_time = 0;
+    for (size_t i = 0; i < sizeof(impl_names) / sizeof(impl_names[0]); i++) {
+        if (vowel_filter_select(impl_names[i]) != 0) {
+            printf("%-10s not supported\n", impl_names[i]);
+            continue;
+        }
+        // Лучшее время из повторов: копия исходника не входит в замер
+        double best_time = 0;
+        int correct = 1;
+        for (int r = 0; r < repeats; r++) {
+            memcpy(work, source, size);
+            struct timespec start, end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            size_t len = vowel_filter(work, size);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            double t = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+            if (r == 0 || t < best_time) best_time = t;
+            if (len != expected_len || memcmp(work, expected, len) != 0) correct = 0;
+        }
+        if (i == 0) reference_time = best_time;
+        printf("%-10s %8.3lf ms  %6.2lf GB/s  x%.1lf%s\n", impl_names[i], best_time * 1e3, size / best_time / 1e9,
+               reference_time / best_time, correct ? "" : "  MISMATCH");
+    }
+
+    free(source);
+    free(work);
+    free(expected);
+    return 0;
+}
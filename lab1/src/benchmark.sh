@@ -0,0 +1,66 @@
+#!/bin/bash
+
+# Пропускная способность пакетного режима lab1: прежний путь (write на строку)
+# против vmsplice из отображённого файла в увеличенные каналы и пакетов frame.h.
+#   ./benchmark.sh [size_gb] [runs]
+# Входной файл можно задать через INPUT=<file>, иначе он генерируется.
+# Сборка и прогон идут во временном каталоге: parent запускает ./child_run оттуда.
+
+SIZE_GB=${1:-2}
+RUNS=${2:-3}
+SRC=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+echo "Throughput benchmark for lab1 pipeline" >&2
+echo "======================================" >&2
+
+gcc -O2 -o "$WORK/parent" "$SRC/parent.c" || exit 1
+gcc -O2 -pthread -o "$WORK/child_run" "$SRC/child.c" "$SRC/../../common/vowel_filter.c" || exit 1
+gcc -O2 -pthread -o "$WORK/pipeline_bench" "$SRC/pipeline_bench.c" -lm || exit 1
+
+if [ -z "$INPUT" ]; then
+    # Кусок в 64 МБ текста из строк по 76 символов, повторённый до нужного размера
+    INPUT="$WORK/input.txt"
+    base64 -w 76 /dev/urandom | head -c $((64 * 1024 * 1024)) > "$WORK/chunk.txt"
+    for ((i = 0; i < SIZE_GB * 16; i++)); do
+        cat "$WORK/chunk.txt"
+    done > "$INPUT"
+    rm -f "$WORK/chunk.txt"
+fi
+echo "Input: $INPUT ($(stat -c %s "$INPUT") bytes)" >&2
+
+cd "$WORK" || exit 1
+for mode in write splice frame; do
+    for ((run = 1; run <= RUNS; run++)); do
+        # Одинаковое зерно - одинаковая раскладка строк по детям в обоих режимах
+        ./parent -m "$mode" -s 1 "out_${mode}_1.txt:80" "out_${mode}_2.txt:20" < "$INPUT" > "report.txt" || exit 1
+        echo "$mode run $run: $(grep '^Time:' report.txt)"
+    done
+done
+
+if cmp -s out_write_1.txt out_splice_1.txt && cmp -s out_write_2.txt out_splice_2.txt &&
+   cmp -s out_write_1.txt out_frame_1.txt && cmp -s out_write_2.txt out_frame_2.txt; then
+    echo "Outputs: identical"
+else
+    echo "Outputs: DIFFER"
+    exit 1
+fi
+
+# Автономный режим: тот же фильтр по кускам файла в нескольких потоках
+TIMEFORMAT="sequential: %R s"
+time ./child_run out_sequential.txt < "$INPUT" || exit 1
+TIMEFORMAT="offline -j $(nproc): %R s"
+time ./child_run -i "$INPUT" -j "$(nproc)" out_offline.txt || exit 1
+if cmp -s out_sequential.txt out_offline.txt; then
+    echo "Offline output: identical"
+else
+    echo "Offline output: DIFFER"
+    exit 1
+fi
+
+# Сквозной замер: строки/с, МБ/с и задержки строк через FIFO
+for mode in write splice frame; do
+    echo "pipeline_bench, mode $mode:"
+    ./pipeline_bench -n 1000000 -- -m "$mode" -s 1 | grep -E '^(Throughput|Latency)' || exit 1
+done
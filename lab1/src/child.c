@@ -1,39 +1,325 @@
+#define _GNU_SOURCE
 #include "os_utils.h"
-#include <ctype.h>
+#include "../../common/vowel_filter.h"
+#include "frame.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-void remove_vowels(char* str) {
-    if (!str) {
-        return;
+// Канал читается крупными блоками: фильтр не зависит от границ строк,
+// поэтому блок обрабатывается целиком, а строки могут быть любой длины.
+// Если родитель увеличил канал, блок берётся размером с канал.
+#define CHILD_BLOCK_SIZE (64 * 1024)
+#define OFFLINE_MIN_SEGMENT (1024 * 1024)   // Меньше на поток не делим
+
+// Запись всего буфера: write может записать меньше запрошенного
+static int write_all(int fd, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= (size_t) n;
+    }
+    return 0;
+}
+
+// Чтение ровно len байт. Возвращает 0 - прочитано, 1 - EOF до первого байта, -1 - ошибка или обрыв.
+static int read_full(int fd, void* buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = read(fd, (char*) buf + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            return done == 0 ? 1 : -1;
+        }
+        done += (size_t) n;
+    }
+    return 0;
+}
+
+// Поток как есть: один read и один write на блок вместо вызовов stdio на каждую строку
+static StatusCode copy_raw(int output) {
+    size_t block_size = CHILD_BLOCK_SIZE;
+    int pipe_size = fcntl(STDIN_FILENO, F_GETPIPE_SZ);
+    if (pipe_size > CHILD_BLOCK_SIZE) {
+        block_size = (size_t) pipe_size;
+    }
+    char* buffer = malloc(block_size);
+    if (buffer == NULL) {
+        return IO_ERROR;
+    }
+    for (;;) {
+        ssize_t bytes_read = read(STDIN_FILENO, buffer, block_size);
+        if (bytes_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            free(buffer);
+            return IO_ERROR;
+        }
+        if (bytes_read == 0) {
+            break;
+        }
+        size_t len = vowel_filter(buffer, (size_t) bytes_read);
+        if (write_all(output, buffer, len) == -1) {
+            free(buffer);
+            return IO_ERROR;
+        }
+    }
+    free(buffer);
+    return STATUS_OK;
+}
+
+// Пакеты протокола frame.h: пакет читается целиком и раскодируется на месте -
+// префикс длины (4 байта) заменяется '\n' после строки, поэтому запись
+// никогда не обгоняет чтение. Затем фильтр и один write на пакет.
+static StatusCode copy_frames(int output) {
+    size_t capacity = FRAME_BATCH_SIZE * 2;
+    char* payload = malloc(capacity);
+    if (payload == NULL) {
+        return IO_ERROR;
+    }
+    StatusCode status = STATUS_OK;
+    for (;;) {
+        FrameHeader header;
+        int rc = read_full(STDIN_FILENO, &header, sizeof(header));
+        if (rc == 1) {
+            break;
+        }
+        if (rc == -1 || header.magic != FRAME_MAGIC) {
+            status = IO_ERROR;
+            break;
+        }
+        if (header.payload_len > capacity) {
+            char* grown = realloc(payload, header.payload_len);
+            if (grown == NULL) {
+                status = IO_ERROR;
+                break;
+            }
+            payload = grown;
+            capacity = header.payload_len;
+        }
+        if (read_full(STDIN_FILENO, payload, header.payload_len) != 0) {
+            status = IO_ERROR;
+            break;
+        }
+
+        size_t read_idx = 0, write_idx = 0;
+        for (uint32_t i = 0; i < header.records; i++) {
+            uint32_t line_len;
+            if (header.payload_len - read_idx < sizeof(line_len)) {
+                break;
+            }
+            memcpy(&line_len, payload + read_idx, sizeof(line_len));
+            read_idx += sizeof(line_len);
+            if (line_len > header.payload_len - read_idx) {
+                break;
+            }
+            memmove(payload + write_idx, payload + read_idx, line_len);
+            write_idx += line_len;
+            payload[write_idx++] = '\n';
+            read_idx += line_len;
+        }
+        if (read_idx != header.payload_len) {
+            status = IO_ERROR;
+            break;
+        }
+        size_t len = vowel_filter(payload, write_idx);
+        if (write_all(output, payload, len) == -1) {
+            status = IO_ERROR;
+            break;
+        }
     }
-    int write_idx = 0;
-    for (int read_idx = 0; str[read_idx] != '\0'; read_idx++) {
-        char c = str[read_idx];
-        char lower_c = tolower((unsigned char) c);
-        if (lower_c != 'a' && lower_c != 'e' && lower_c != 'i' && lower_c != 'o' && lower_c != 'u' && lower_c != 'y') {
-            str[write_idx++] = c;
+    free(payload);
+    return status;
+}
+
+// ---------- Автономный режим: файл целиком ----------
+// Вход отображается в память и делится на куски по границам строк. Потоки
+// фильтруют свои куски на месте (MAP_PRIVATE: страницы копируются при записи,
+// файл не меняется). Затем префиксные суммы длин дают смещения кусков в
+// выходном файле, и потоки пишут их через pwrite.
+
+typedef struct {
+    char* data;
+    size_t begin, end;          // Кусок [begin, end), end - сразу после '\n'
+    size_t filtered;            // Длина куска после фильтра
+    off_t offset;               // Смещение в выходном файле
+    int output;
+    StatusCode status;
+} Segment;
+
+static int pwrite_all(int fd, const char* buf, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
         }
+        buf += n;
+        len -= (size_t) n;
+        offset += n;
     }
-    str[write_idx] = '\0';
+    return 0;
+}
+
+static void* filter_segment(void* arg) {
+    Segment* segment = arg;
+    segment->filtered = vowel_filter(segment->data + segment->begin, segment->end - segment->begin);
+    return NULL;
 }
 
+static void* write_segment(void* arg) {
+    Segment* segment = arg;
+    if (pwrite_all(segment->output, segment->data + segment->begin, segment->filtered, segment->offset) == -1) {
+        segment->status = IO_ERROR;
+    }
+    return NULL;
+}
+
+// По потоку на кусок; если поток не создался, кусок обрабатывается здесь же
+static void run_segments(Segment* segments, int count, void* (*fn)(void*), pthread_t* ids) {
+    int* started = calloc((size_t) count, sizeof(int));
+    for (int i = 0; i < count; i++) {
+        if (started != NULL && i > 0 && pthread_create(&ids[i], NULL, fn, &segments[i]) == 0) {
+            started[i] = 1;
+        }
+    }
+    // Первый кусок - в вызывающем потоке, вместе с теми, для кого поток не создался
+    for (int i = 0; i < count; i++) {
+        if (started == NULL || !started[i]) {
+            fn(&segments[i]);
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (started != NULL && started[i]) {
+            pthread_join(ids[i], NULL);
+        }
+    }
+    free(started);
+}
+
+static StatusCode filter_file(const char* input_name, int output, int threads) {
+    int input = open(input_name, O_RDONLY);
+    if (input == -1) {
+        return FILE_OPEN_ERROR;
+    }
+    struct stat st;
+    if (fstat(input, &st) == -1) {
+        close(input);
+        return IO_ERROR;
+    }
+    size_t size = (size_t) st.st_size;
+    if (size == 0) {
+        close(input);
+        return STATUS_OK;
+    }
+    char* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, input, 0);
+    close(input);
+    if (data == MAP_FAILED) {
+        return IO_ERROR;
+    }
+
+    // Мелкие файлы не стоит делить на много потоков
+    if ((size_t) threads > size / OFFLINE_MIN_SEGMENT + 1) {
+        threads = (int) (size / OFFLINE_MIN_SEGMENT + 1);
+    }
+    Segment* segments = calloc((size_t) threads, sizeof(Segment));
+    pthread_t* ids = malloc(sizeof(pthread_t) * (size_t) threads);
+    if (segments == NULL || ids == NULL) {
+        free(segments);
+        free(ids);
+        munmap(data, size);
+        return IO_ERROR;
+    }
+
+    // Граница куска - первый '\n' после равной доли оставшейся части файла.
+    // Доля считается от текущего начала: длинная строка, перескочившая
+    // границу, не сваливает весь остаток файла в один кусок.
+    int count = 0;
+    size_t begin = 0;
+    while (begin < size) {
+        size_t end = size;
+        size_t target = begin + (size - begin) / (size_t) (threads - count);
+        if (count < threads - 1 && target > begin) {
+            const char* newline = memchr(data + target - 1, '\n', size - target + 1);
+            end = newline ? (size_t) (newline - data) + 1 : size;
+        }
+        segments[count].data = data;
+        segments[count].begin = begin;
+        segments[count].end = end;
+        segments[count].output = output;
+        count++;
+        begin = end;
+    }
+
+    run_segments(segments, count, filter_segment, ids);
+    off_t offset = 0;
+    for (int i = 0; i < count; i++) {
+        segments[i].offset = offset;
+        offset += (off_t) segments[i].filtered;
+    }
+    run_segments(segments, count, write_segment, ids);
+
+    StatusCode status = STATUS_OK;
+    for (int i = 0; i < count; i++) {
+        if (segments[i].status != STATUS_OK) {
+            status = segments[i].status;
+        }
+    }
+    free(segments);
+    free(ids);
+    munmap(data, size);
+    return status;
+}
+
+// child_run [-f] <output_file>: -f - вход в пакетном протоколе frame.h
+// child_run -i <input_file> [-j threads] <output_file>: автономный режим
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
+    int framed = 0;
+    const char* input_name = NULL;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+    while ((opt = getopt(argc, argv, "fi:j:")) != -1) {
+        if (opt == 'f') {
+            framed = 1;
+        } else if (opt == 'i') {
+            input_name = optarg;
+        } else if (opt == 'j' && (threads = atol(optarg)) > 0 && threads <= 1024) {
+            continue;
+        } else {
+            return INVALID_INPUT;
+        }
+    }
+    if (optind != argc - 1 || (framed && input_name != NULL)) {
         return INVALID_INPUT;
     }
-    const char* output_name = argv[1];
-    FILE* output = NULL;
-    char buffer[1024];
+    if (threads < 1) {
+        threads = 1;
+    }
+    const char* output_name = argv[optind];
 
-    output = fopen(output_name, "w");
-    if (output == NULL) {
+    int output = open(output_name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (output == -1) {
         return FILE_OPEN_ERROR;
     }
-    while (fgets(buffer, sizeof(buffer), stdin) != NULL) {
-        remove_vowels(buffer);
-        if (fputs(buffer, output) == EOF) {
-            return IO_ERROR;
-        }
+    StatusCode status = input_name != NULL ? filter_file(input_name, output, (int) threads)
+                        : framed ? copy_frames(output) : copy_raw(output);
+    if (close(output) == -1 && status == STATUS_OK) {
+        status = IO_ERROR;
     }
-    fclose(output);
-    return STATUS_OK;
+    return status;
 }
\ No newline at end of file
@@ -0,0 +1,21 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+
+// Пакетный протокол родитель -> ребёнок (ребёнок запускается с флагом -f).
+// Пакет: заголовок FrameHeader и payload_len байт записей; запись - длина
+// строки (uint32_t, порядок байтов хоста) и сама строка без '\n'.
+// Ребёнок получает пакет целиком и пишет строки, разделяя их '\n'.
+
+#define FRAME_MAGIC 0x314D5246u            // "FRM1"
+#define FRAME_BATCH_SIZE (64 * 1024)        // Пакет уходит, как только записи заняли столько байт
+#define FRAME_FLUSH_MS 10                   // По умолчанию пакет ждёт новых строк не дольше
+
+typedef struct {
+    uint32_t magic;
+    uint32_t records;       // Число строк в пакете
+    uint32_t payload_len;   // Байт после заголовка
+} FrameHeader;
+
+#endif
@@ -0,0 +1,67 @@
+#!/bin/bash
+
+# Проверка срока -t в режиме frame при непрерывном вводе. stdin - обычный
+# файл, поэтому poll всегда сообщает о готовности и никогда не истекает.
+# Первый ребёнок пишет в именованный канал, который читается медленно,
+# и родитель всё время занят; второму ребёнку достаётся одна строка из
+# тысячи. Его пакеты обязаны уходить по сроку, а не ждать заполнения до
+# FRAME_BATCH_SIZE или конца ввода: выход второго ребёнка должен расти
+# не реже, чем раз в -t мс (с запасом на планировщик).
+#   ./frame_flush_test.sh [flush_ms]
+
+FLUSH_MS=${1:-20}
+LIMIT_MS=$((FLUSH_MS + 250))
+SRC=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+gcc -O2 -o "$WORK/parent" "$SRC/parent.c" || exit 1
+gcc -O2 -pthread -o "$WORK/child_run" "$SRC/child.c" "$SRC/../../common/vowel_filter.c" || exit 1
+
+cd "$WORK" || exit 1
+# 16 МБ строк по 76 символов: при чтении канала ~4 МБ/с прогон идёт около 4 секунд
+base64 -w 76 /dev/urandom | head -c $((16 * 1024 * 1024)) > input.txt
+mkfifo majority.fifo
+
+python3 - "$FLUSH_MS" "$LIMIT_MS" <<'PY'
+import os, subprocess, sys, threading, time
+
+flush_ms, limit_ms = int(sys.argv[1]), int(sys.argv[2])
+with open("input.txt", "rb") as stdin:
+    parent = subprocess.Popen(["./parent", "-m", "frame", "-t", str(flush_ms), "-s", "1",
+                               "majority.fifo:1000", "minority.txt:1"],
+                              stdin=stdin, stdout=subprocess.DEVNULL)
+
+# Медленный читатель первого ребёнка держит родителя занятым
+def drain():
+    with open("majority.fifo", "rb") as fifo:
+        while fifo.read(64 * 1024):
+            time.sleep(0.016)
+reader = threading.Thread(target=drain)
+reader.start()
+
+start = time.monotonic()
+last_size, last_growth, worst_gap, growths = 0, start, 0.0, 0
+while parent.poll() is None:
+    time.sleep(0.002)
+    try:
+        size = os.path.getsize("minority.txt")
+    except OSError:
+        continue
+    now = time.monotonic()
+    if size > last_size:
+        worst_gap = max(worst_gap, now - last_growth)
+        last_size, last_growth = size, now
+        growths += 1
+elapsed = time.monotonic() - start
+reader.join()
+
+print("run %.2f s, minority output grew %d times, worst gap %.0f ms" % (elapsed, growths, worst_gap * 1000))
+if parent.returncode != 0:
+    sys.exit("FAIL: parent exited with %d" % parent.returncode)
+if elapsed < 1.0:
+    sys.exit("FAIL: input was drained too fast to keep stdin busy")
+if growths < 2 or worst_gap * 1000 > limit_ms:
+    sys.exit("FAIL: minority frames were not flushed within -t %d ms" % flush_ms)
+print("OK")
+PY
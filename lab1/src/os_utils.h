@@ -18,6 +18,4 @@ typedef enum {
     IO_ERROR = 6
 } StatusCode;
 
-void remove_vowels(char* str);
-
 #endif
\ No newline at end of file
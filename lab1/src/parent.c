@@ -1,15 +1,33 @@
+#define _GNU_SOURCE
 #include "os_utils.h" 
+#include "frame.h"
 #include <stdio.h>    
 #include <string.h>    
 #include <unistd.h>    
 #include <stdlib.h>    
 #include <sys/wait.h>  // Функции для ожидания процессов (waitpid)
 #include <time.h>     
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <poll.h>
+#include <stdint.h>
 
 #define MAX_LINE_LENGTH 1024      
 #define MAX_FILENAME_LENGTH 256    
 
-void start_child_process(int read_fd, const char* child_program, const char* output_name) {
+// Пакетный режим: строки берутся из stdin целиком, без ограничения длины
+#define BULK_PIPE_SIZE (1024 * 1024)    // Размер канала для splice (не больше pipe-max-size)
+#define BULK_READ_SIZE (1024 * 1024)    // Блок чтения, если stdin нельзя отобразить
+#define BULK_IOV_COUNT 1024             // Строк в одном вызове vmsplice/writev
+#define BULK_QUEUE_LIMIT (4 * 1024 * 1024)  // Допустимый долг ребёнка в режиме epoll
+
+// framed - ребёнок читает пакеты протокола frame.h
+void start_child_process(int read_fd, const char* child_program, const char* output_name, int framed) {
     // Перенаправляем стандартный ввод (stdin) на чтение из канала
     if (dup2(read_fd, STDIN_FILENO) == -1) {
         perror("Ошибка dup2"); 
@@ -17,13 +35,1065 @@ void start_child_process(int read_fd, const char* child_program, const char* out
     }
     close(read_fd);  
     
-    execlp(child_program, child_program, (char* )output_name, (char* )NULL);
+    if (framed) {
+        execlp(child_program, child_program, "-f", (char* )output_name, (char* )NULL);
+    } else {
+        execlp(child_program, child_program, (char* )output_name, (char* )NULL);
+    }
     
     perror("Ошибка execlp");
     exit(EXEC_ERROR); 
 }
 
-int main() {
+// xorshift64: быстрее rand() и без общей блокировки внутри libc
+static uint64_t xorshift64(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+// Распределение строк по N детям пропорционально весам: случайно
+// или детерминированным плавным round-robin (веса 3:1 дают 0 0 1 0 0 0 1 0 ...)
+typedef struct {
+    int count;
+    const unsigned* weights;
+    unsigned long long total;           // Сумма весов
+    unsigned long long* cumulative;     // cumulative[i] - сумма весов 0..i
+    long long* current;                 // Накопленный вес каждого ребёнка для round-robin
+    int round_robin;
+    uint64_t state;
+} Router;
+
+static int router_init(Router* router, const unsigned* weights, int count, int round_robin, uint64_t seed) {
+    router->count = count;
+    router->weights = weights;
+    router->round_robin = round_robin;
+    router->state = seed ? seed : 0x9E3779B97F4A7C15ull;   // Нулевое состояние xorshift не меняется
+    router->cumulative = malloc(sizeof(unsigned long long) * count);
+    router->current = calloc(count, sizeof(long long));
+    if (router->cumulative == NULL || router->current == NULL) {
+        free(router->cumulative);
+        free(router->current);
+        return -1;
+    }
+    router->total = 0;
+    for (int i = 0; i < count; i++) {
+        router->total += weights[i];
+        router->cumulative[i] = router->total;
+    }
+    return 0;
+}
+
+static void router_free(Router* router) {
+    free(router->cumulative);
+    free(router->current);
+}
+
+static int router_pick(Router* router) {
+    if (router->round_robin) {
+        int best = 0;
+        for (int i = 0; i < router->count; i++) {
+            router->current[i] += router->weights[i];
+            if (router->current[i] > router->current[best]) {
+                best = i;
+            }
+        }
+        router->current[best] -= (long long) router->total;
+        return best;
+    }
+    // Число в [0, total) без деления: старшие биты произведения
+    unsigned long long r = (unsigned long long) (((unsigned __int128) xorshift64(&router->state) * router->total) >> 64);
+    int lo = 0, hi = router->count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (r < router->cumulative[mid]) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+// Накопленные для одного канала строки. Соседние строки, идущие
+// в один канал, лежат в памяти подряд и склеиваются в один iovec.
+typedef struct {
+    int fd;
+    struct iovec iov[BULK_IOV_COUNT];
+    int count;
+    unsigned long long bytes;
+    unsigned long long lines;
+} PipeBatch;
+
+// Дети пакетного режима: по каналу на каждого и общий маршрутизатор
+typedef struct {
+    int count;
+    PipeBatch* batches;
+    Router router;
+    int zero_copy;
+} Workers;
+
+// vmsplice передаёт ссылки на страницы в канал без копирования; страницы
+// нельзя менять, пока ребёнок их не прочитал, поэтому годится только для
+// отображённого файла. Остальное отправляется writev - одной копией на пакет.
+static int flush_batch(PipeBatch* batch, int zero_copy) {
+    struct iovec* iov = batch->iov;
+    int count = batch->count;
+    while (count > 0) {
+        ssize_t n = zero_copy ? vmsplice(batch->fd, iov, count, 0) : writev(batch->fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        // Пропускаем полностью переданные элементы, последний - сдвигаем
+        while (count > 0 && (size_t) n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*) iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    batch->count = 0;
+    return 0;
+}
+
+static int batch_add(PipeBatch* batch, const char* data, size_t len, int zero_copy) {
+    batch->bytes += len;
+    if (batch->count > 0) {
+        struct iovec* last = &batch->iov[batch->count - 1];
+        if ((const char*) last->iov_base + last->iov_len == data) {
+            last->iov_len += len;
+            return 0;
+        }
+    }
+    if (batch->count == BULK_IOV_COUNT && flush_batch(batch, zero_copy) == -1) {
+        return -1;
+    }
+    batch->iov[batch->count].iov_base = (void*) data;
+    batch->iov[batch->count].iov_len = len;
+    batch->count++;
+    return 0;
+}
+
+static int flush_all(Workers* workers) {
+    for (int i = 0; i < workers->count; i++) {
+        if (flush_batch(&workers->batches[i], workers->zero_copy) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Раскладывает полные строки из [data, data + len) по каналам.
+// Возвращает число разобранных байт (хвост без '\n' остаётся), -1 при ошибке.
+// at_eof: хвост - последняя строка, ей добавляется перевод строки.
+// *quit становится 1 на строке "QUIT", как в интерактивном режиме.
+static ssize_t route_lines(Workers* workers, const char* data, size_t len, int at_eof, int* quit) {
+    static const char newline = '\n';
+    size_t pos = 0;
+    while (pos < len) {
+        const char* end = memchr(data + pos, '\n', len - pos);
+        if (end == NULL && !at_eof) {
+            break;
+        }
+        size_t line_len = end ? (size_t) (end - (data + pos)) : len - pos;
+        if (line_len == 4 && memcmp(data + pos, "QUIT", 4) == 0) {
+            *quit = 1;
+            break;
+        }
+        PipeBatch* batch = &workers->batches[router_pick(&workers->router)];
+        batch->lines++;
+        if (batch_add(batch, data + pos, line_len + (end ? 1 : 0), workers->zero_copy) == -1 ||
+            (!end && batch_add(batch, &newline, 1, workers->zero_copy) == -1)) {
+            return -1;
+        }
+        pos += line_len + (end ? 1 : 0);
+    }
+    return (ssize_t) pos;
+}
+
+// Поток stdin, который нельзя отобразить (канал, терминал): блоки читаются
+// в буфер, неполная строка переносится в начало буфера перед следующим чтением
+static int bulk_copy_stream(Workers* workers) {
+    // Буфер перезаписывается следующим чтением - только копирующий writev
+    workers->zero_copy = 0;
+    size_t capacity = BULK_READ_SIZE;
+    size_t filled = 0;
+    char* buffer = malloc(capacity);
+    if (buffer == NULL) {
+        return -1;
+    }
+    int quit = 0, eof = 0;
+    while (!quit && !eof) {
+        if (filled == capacity) {
+            // Строка длиннее буфера
+            char* grown = realloc(buffer, capacity * 2);
+            if (grown == NULL) {
+                free(buffer);
+                return -1;
+            }
+            buffer = grown;
+            capacity *= 2;
+        }
+        ssize_t n = read(STDIN_FILENO, buffer + filled, capacity - filled);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            free(buffer);
+            return -1;
+        }
+        eof = n == 0;
+        filled += n;
+        ssize_t used = route_lines(workers, buffer, filled, eof, &quit);
+        // Перед перезаписью буфера всё накопленное должно уйти в каналы
+        if (used < 0 || flush_all(workers) == -1) {
+            free(buffer);
+            return -1;
+        }
+        memmove(buffer, buffer + used, filled - used);
+        filled -= used;
+    }
+    free(buffer);
+    return 0;
+}
+
+// Прежний путь для сравнения: строка за строкой, по write на строку
+static int bulk_write_lines(Workers* workers) {
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t len;
+    int status = 0;
+    while ((len = getline(&line, &capacity, stdin)) > 0) {
+        if (line[len - 1] == '\n') {
+            len--;
+        }
+        if (len == 4 && memcmp(line, "QUIT", 4) == 0) {
+            break;
+        }
+        line[len++] = '\n';    // getline оставляет место под '\0'
+        PipeBatch* batch = &workers->batches[router_pick(&workers->router)];
+        batch->lines++;
+        batch->bytes += len;
+        if (write(batch->fd, line, len) != len) {
+            status = -1;
+            break;
+        }
+    }
+    free(line);
+    return status;
+}
+
+// ---------- Режим epoll ----------
+// Каналы неблокирующие, у каждого ребёнка своя очередь в памяти родителя.
+// Долг ребёнка - байты в его очереди плюс непрочитанное в канале (FIONREAD).
+// Строка идёт ребёнку, выбранному маршрутизатором, если его долг меньше
+// предела; иначе она отдаётся наименее загруженному с учётом веса
+// (rebalance) или отбрасывается (shed). Перед этим ребёнку с превышенным
+// пределом даётся один раунд epoll_wait (до 1 мс), чтобы он успел прочитать
+// канал: иначе пока разбирается буфер ввода, быстрый ребёнок не получает
+// процессор и выглядит отстающим. Медленный ребёнок не останавливает
+// остальных: родитель ждёт, только когда предел превышен у всех.
+
+typedef struct {
+    char* data;
+    size_t head;            // Начало неотправленных данных
+    size_t tail;            // Конец данных
+    size_t capacity;
+    size_t in_pipe;         // FIONREAD канала на последней проверке
+    int armed;              // Ждём EPOLLOUT
+    int waited;             // Раунд ожидания при превышенном пределе уже дан
+    unsigned long long rerouted;    // Строки, принятые вместо перегруженного ребёнка
+    unsigned long long dropped;     // Строки, отброшенные вместо отправки этому ребёнку
+} ChildQueue;
+
+static size_t queue_backlog(const ChildQueue* queue) {
+    return queue->tail - queue->head + queue->in_pipe;
+}
+
+static int queue_push(ChildQueue* queue, const char* data, size_t len, int add_newline) {
+    size_t need = len + (add_newline ? 1 : 0);
+    if (queue->tail + need > queue->capacity) {
+        // Сначала сдвигаем неотправленное в начало, потом при необходимости растём
+        memmove(queue->data, queue->data + queue->head, queue->tail - queue->head);
+        queue->tail -= queue->head;
+        queue->head = 0;
+        if (queue->tail + need > queue->capacity) {
+            size_t capacity = queue->capacity ? queue->capacity : 64 * 1024;
+            while (queue->tail + need > capacity) {
+                capacity *= 2;
+            }
+            char* grown = realloc(queue->data, capacity);
+            if (grown == NULL) {
+                return -1;
+            }
+            queue->data = grown;
+            queue->capacity = capacity;
+        }
+    }
+    memcpy(queue->data + queue->tail, data, len);
+    queue->tail += len;
+    if (add_newline) {
+        queue->data[queue->tail++] = '\n';
+    }
+    return 0;
+}
+
+// Отправка очереди без блокировки. Возвращает -1 при ошибке канала.
+static int queue_drain(ChildQueue* queue, int fd) {
+    while (queue->head < queue->tail) {
+        ssize_t n = write(fd, queue->data + queue->head, queue->tail - queue->head);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                break;
+            }
+            return -1;
+        }
+        queue->head += n;
+    }
+    if (queue->head == queue->tail) {
+        queue->head = queue->tail = 0;
+    }
+    int pending = 0;
+    if (ioctl(fd, FIONREAD, &pending) == 0) {
+        queue->in_pipe = (size_t) pending;
+    }
+    return 0;
+}
+
+// Превышен ли предел. Долг по данным прошлой отправки устаревает, пока
+// разбирается буфер ввода: перед отказом очередь отправляется и FIONREAD
+// перечитывается, так что перегруженным считается только ребёнок, чей
+// канал не принял всё (EAGAIN) и долг которого всё ещё не меньше предела.
+static int queue_over_limit(ChildQueue* queue, int fd, size_t limit) {
+    if (queue_backlog(queue) >= limit) {
+        queue_drain(queue, fd);
+    }
+    if (queue_backlog(queue) < limit) {
+        queue->waited = 0;
+        return 0;
+    }
+    return 1;
+}
+
+// Куда отправить строку, предназначенную preferred: номер ребёнка,
+// -1 - все перегружены (ждать), -2 - отбросить строку.
+// Замена ищется новыми выборами маршрутизатора, чтобы нагрузка делилась
+// между свободными детьми по весам, а если не повезло - по наименьшему долгу.
+static int choose_child(Workers* workers, ChildQueue* queues, int preferred, size_t limit, int shed) {
+    if (!queue_over_limit(&queues[preferred], workers->batches[preferred].fd, limit)) {
+        return preferred;
+    }
+    if (shed) {
+        return -2;
+    }
+    for (int attempt = 0; attempt < workers->count; attempt++) {
+        int other = router_pick(&workers->router);
+        if (!queue_over_limit(&queues[other], workers->batches[other].fd, limit)) {
+            return other;
+        }
+    }
+    int best = -1;
+    double best_load = 0;
+    for (int i = 0; i < workers->count; i++) {
+        if (queue_over_limit(&queues[i], workers->batches[i].fd, limit)) {
+            continue;
+        }
+        double load = (double) queue_backlog(&queues[i]) / workers->router.weights[i];
+        if (best == -1 || load < best_load) {
+            best = i;
+            best_load = load;
+        }
+    }
+    return best;
+}
+
+static int set_interest(int epfd, int fd, uint32_t index, uint32_t events) {
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.u32 = index;
+    return epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+static int bulk_epoll(Workers* workers, ChildQueue* queues, size_t limit, int shed) {
+    int count = workers->count;
+    int epfd = epoll_create1(0);
+    if (epfd == -1) {
+        return -1;
+    }
+    struct epoll_event ev;
+    for (int i = 0; i < count; i++) {
+        int fd = workers->batches[i].fd;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        ev.events = 0;
+        ev.data.u32 = (uint32_t) i;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            close(epfd);
+            return -1;
+        }
+    }
+    // Обычный файл epoll не поддерживает (EPERM): он всегда готов к чтению
+    ev.events = 0;
+    ev.data.u32 = (uint32_t) count;
+    int stdin_polled = epoll_ctl(epfd, EPOLL_CTL_ADD, STDIN_FILENO, &ev) == 0;
+    int stdin_armed = 0;
+
+    size_t capacity = BULK_READ_SIZE;
+    size_t parsed = 0, filled = 0;
+    char* buffer = malloc(capacity);
+    int input_done = 0;     // EOF или строка QUIT
+    int input_ready = !stdin_polled;
+    int preferred = -1;     // Выбор маршрутизатора для строки, ждущей места
+    int status = 0;
+    struct epoll_event events[64];
+
+    while (buffer != NULL && status == 0) {
+        // Чтение, если вход готов и в буфере есть место
+        if (!input_done && input_ready) {
+            if (parsed > 0) {
+                memmove(buffer, buffer + parsed, filled - parsed);
+                filled -= parsed;
+                parsed = 0;
+            }
+            if (filled == capacity) {
+                char* grown = realloc(buffer, capacity * 2);
+                if (grown == NULL) {
+                    status = -1;
+                    break;
+                }
+                buffer = grown;
+                capacity *= 2;
+            }
+            ssize_t n = read(STDIN_FILENO, buffer + filled, capacity - filled);
+            if (n < 0 && errno != EINTR && errno != EAGAIN) {
+                status = -1;
+                break;
+            }
+            if (n == 0) {
+                input_done = 1;
+            }
+            if (n > 0) {
+                filled += n;
+            }
+            if (stdin_polled) {
+                input_ready = 0;
+            }
+        }
+
+        // Раскладка полных строк по очередям, пока есть куда класть
+        int stalled = 0;
+        int grace = 0;      // Ждём раунд epoll ради ребёнка preferred
+        while (parsed < filled) {
+            const char* line = buffer + parsed;
+            const char* end = memchr(line, '\n', filled - parsed);
+            if (end == NULL && !input_done) {
+                break;
+            }
+            size_t line_len = end ? (size_t) (end - line) : filled - parsed;
+            if (line_len == 4 && memcmp(line, "QUIT", 4) == 0) {
+                input_done = 1;
+                parsed = filled;
+                break;
+            }
+            if (preferred == -1) {
+                preferred = router_pick(&workers->router);
+            }
+            if (!queues[preferred].waited &&
+                queue_over_limit(&queues[preferred], workers->batches[preferred].fd, limit)) {
+                grace = 1;
+                break;
+            }
+            int target = choose_child(workers, queues, preferred, limit, shed);
+            if (target == -1) {
+                stalled = 1;
+                break;
+            }
+            if (target == -2) {
+                queues[preferred].dropped++;
+            } else {
+                if (queue_push(&queues[target], line, line_len + (end ? 1 : 0), end == NULL) == -1) {
+                    status = -1;
+                    break;
+                }
+                if (target != preferred) {
+                    queues[target].rerouted++;
+                }
+                workers->batches[target].lines++;
+                workers->batches[target].bytes += line_len + 1;
+            }
+            preferred = -1;
+            parsed += line_len + (end ? 1 : 0);
+        }
+
+        // Отправка и подписка на EPOLLOUT только для непустых очередей
+        int pending = 0;
+        for (int i = 0; i < count && status == 0; i++) {
+            if (queue_drain(&queues[i], workers->batches[i].fd) == -1) {
+                status = -1;
+                break;
+            }
+            int want = queues[i].head < queues[i].tail;
+            pending |= want;
+            if (want != queues[i].armed) {
+                set_interest(epfd, workers->batches[i].fd, (uint32_t) i, want ? EPOLLOUT : 0);
+                queues[i].armed = want;
+            }
+        }
+        if (status != 0) {
+            break;
+        }
+        if (input_done && parsed == filled && !pending) {
+            break;
+        }
+
+        // Вход читаем, только когда строки из буфера разложены
+        int want_input = !input_done && !stalled && !grace;
+        if (stdin_polled && want_input != stdin_armed) {
+            set_interest(epfd, STDIN_FILENO, (uint32_t) count, want_input ? EPOLLIN : 0);
+            stdin_armed = want_input;
+        }
+        // Файл на входе готов всегда: ждать нужно, только если все дети перегружены.
+        // Если ждать нечего, но ребёнок не читает канал, а очередь пуста,
+        // долг уменьшится только в канале - проверяем его раз в 10 мс.
+        int timeout = (!stdin_polled && want_input) ? 0 : grace ? 1 : (stalled && !pending ? 10 : -1);
+        int n = epoll_wait(epfd, events, 64, timeout);
+        if (n < 0 && errno != EINTR) {
+            status = -1;
+            break;
+        }
+        for (int k = 0; k < n; k++) {
+            if (events[k].data.u32 == (uint32_t) count) {
+                input_ready = 1;
+            }
+        }
+        if (!stdin_polled) {
+            input_ready = want_input;
+        }
+        if (grace) {
+            queues[preferred].waited = 1;
+        }
+        if (stalled && !pending) {
+            for (int i = 0; i < count; i++) {
+                queue_drain(&queues[i], workers->batches[i].fd);
+            }
+        }
+    }
+    free(buffer);
+    close(epfd);
+    return buffer == NULL ? -1 : status;
+}
+
+// ---------- Пакетный протокол ----------
+// Строки каждого ребёнка копятся в пакет с префиксами длины; пакет уходит
+// одним writev (заголовок + записи), когда набрал FRAME_BATCH_SIZE байт
+// или когда его первая строка ждёт дольше flush_ms. Так на много строк
+// приходится один системный вызов, а задержка строки ограничена.
+
+typedef struct {
+    FrameHeader header;
+    char* payload;
+    size_t capacity;
+    struct timespec first;  // Когда в пустой пакет попала первая строка
+} FrameBatch;
+
+static long long elapsed_ms(const struct timespec* since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000LL + (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+static int frame_flush(FrameBatch* frame, int fd) {
+    if (frame->header.records == 0) {
+        return 0;
+    }
+    struct iovec iov[2] = {
+        { &frame->header, sizeof(frame->header) },
+        { frame->payload, frame->header.payload_len },
+    };
+    struct iovec* pos = iov;
+    int count = 2;
+    while (count > 0) {
+        ssize_t n = writev(fd, pos, count);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        while (count > 0 && (size_t) n >= pos->iov_len) {
+            n -= pos->iov_len;
+            pos++;
+            count--;
+        }
+        if (count > 0) {
+            pos->iov_base = (char*) pos->iov_base + n;
+            pos->iov_len -= n;
+        }
+    }
+    frame->header.records = 0;
+    frame->header.payload_len = 0;
+    return 0;
+}
+
+static int frame_add(FrameBatch* frame, const char* line, size_t len) {
+    uint32_t prefix = (uint32_t) len;
+    size_t need = frame->header.payload_len + sizeof(prefix) + len;
+    if (need > UINT32_MAX) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    if (need > frame->capacity) {
+        size_t capacity = frame->capacity ? frame->capacity : FRAME_BATCH_SIZE * 2;
+        while (capacity < need) {
+            capacity *= 2;
+        }
+        char* grown = realloc(frame->payload, capacity);
+        if (grown == NULL) {
+            return -1;
+        }
+        frame->payload = grown;
+        frame->capacity = capacity;
+    }
+    if (frame->header.records == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &frame->first);
+    }
+    memcpy(frame->payload + frame->header.payload_len, &prefix, sizeof(prefix));
+    memcpy(frame->payload + frame->header.payload_len + sizeof(prefix), line, len);
+    frame->header.payload_len = (uint32_t) need;
+    frame->header.records++;
+    return 0;
+}
+
+// Журнал отправки: log_every = 0 - только итоговые счётчики,
+// 1 - каждая строка, N - каждая N-я строка
+static void log_line(unsigned long long line_no, int child, unsigned long long log_every) {
+    if (log_every == 0 || line_no % log_every != 0) {
+        return;
+    }
+    char message[MAX_LINE_LENGTH];
+    int n = snprintf(message, sizeof(message), "Отправлено в Child %d (строка %llu)\n", child + 1, line_no + 1);
+    write(STDOUT_FILENO, message, n);
+}
+
+// Отправка пакетов, первая строка которых ждёт уже flush_ms или дольше
+static int flush_expired(FrameBatch* frames, Workers* workers, int flush_ms) {
+    for (int i = 0; i < workers->count; i++) {
+        if (frames[i].header.records > 0 && elapsed_ms(&frames[i].first) >= flush_ms &&
+            frame_flush(&frames[i], workers->batches[i].fd) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Чтение stdin, раскладка строк по пакетам детей и отправка пакетов
+static int dispatch_frames(Workers* workers, int flush_ms, unsigned long long log_every) {
+    int count = workers->count;
+    FrameBatch* frames = calloc(count, sizeof(FrameBatch));
+    size_t capacity = BULK_READ_SIZE;
+    size_t filled = 0;
+    char* buffer = malloc(capacity);
+    int status = 0, quit = 0, eof = 0;
+    unsigned long long line_no = 0;
+    if (frames == NULL || buffer == NULL) {
+        free(frames);
+        free(buffer);
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        frames[i].header.magic = FRAME_MAGIC;
+    }
+
+    while (status == 0 && !quit && !eof) {
+        // Пока есть неотправленный пакет, ждём ввода не дольше его срока
+        int timeout = -1;
+        for (int i = 0; i < count; i++) {
+            if (frames[i].header.records > 0) {
+                long long left = flush_ms - elapsed_ms(&frames[i].first);
+                if (left < 0) {
+                    left = 0;
+                }
+                if (timeout == -1 || left < timeout) {
+                    timeout = (int) left;
+                }
+            }
+        }
+        if (timeout >= 0) {
+            struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+            int ready = poll(&pfd, 1, timeout);
+            if (ready < 0 && errno != EINTR) {
+                status = -1;
+                break;
+            }
+            if (ready <= 0) {
+                status = flush_expired(frames, workers, flush_ms);
+                continue;
+            }
+        }
+
+        if (filled == capacity) {
+            // Строка длиннее буфера
+            char* grown = realloc(buffer, capacity * 2);
+            if (grown == NULL) {
+                status = -1;
+                break;
+            }
+            buffer = grown;
+            capacity *= 2;
+        }
+        ssize_t n = read(STDIN_FILENO, buffer + filled, capacity - filled);
+        if (n < 0) {
+            if (errno != EINTR) {
+                status = -1;
+            }
+            continue;
+        }
+        eof = n == 0;
+        filled += n;
+
+        size_t pos = 0;
+        while (pos < filled) {
+            const char* end = memchr(buffer + pos, '\n', filled - pos);
+            if (end == NULL && !eof) {
+                break;
+            }
+            size_t line_len = end ? (size_t) (end - (buffer + pos)) : filled - pos;
+            if (line_len == 4 && memcmp(buffer + pos, "QUIT", 4) == 0) {
+                quit = 1;
+                break;
+            }
+            int child = router_pick(&workers->router);
+            FrameBatch* frame = &frames[child];
+            if (frame_add(frame, buffer + pos, line_len) == -1) {
+                status = -1;
+                break;
+            }
+            // Отправка полного пакета может надолго заблокироваться на медленном
+            // ребёнке, поэтому после неё проверяются и сроки остальных пакетов
+            if (frame->header.payload_len >= FRAME_BATCH_SIZE &&
+                (frame_flush(frame, workers->batches[child].fd) == -1 || flush_expired(frames, workers, flush_ms) == -1)) {
+                status = -1;
+                break;
+            }
+            workers->batches[child].lines++;
+            workers->batches[child].bytes += line_len + 1;
+            log_line(line_no++, child, log_every);
+            pos += line_len + (end ? 1 : 0);
+        }
+        memmove(buffer, buffer + pos, filled - pos);
+        filled -= pos;
+
+        // При непрерывном вводе poll не истекает никогда: сроки проверяются
+        // после каждого прохода, иначе пакет редко выбираемого ребёнка ждал бы
+        // заполнения до FRAME_BATCH_SIZE
+        if (status == 0) {
+            status = flush_expired(frames, workers, flush_ms);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (status == 0) {
+            status = frame_flush(&frames[i], workers->batches[i].fd);
+        }
+        free(frames[i].payload);
+    }
+    free(frames);
+    free(buffer);
+    return status;
+}
+
+// ---------- Расход ресурсов процессов ----------
+// getrusage даёт время и переключения контекста, а число системных вызовов
+// чтения и записи ядро ведёт в /proc/<pid>/io. Файл ребёнка читается, пока
+// тот ещё зомби (waitid с WNOWAIT), и только потом ребёнок забирается wait4.
+
+typedef struct {
+    struct rusage usage;
+    unsigned long long syscr;   // read, readv, pread, splice со стороны чтения...
+    unsigned long long syscw;   // write, writev, vmsplice...
+} ProcessUsage;
+
+static void read_proc_io(const char* path, ProcessUsage* usage) {
+    usage->syscr = usage->syscw = 0;
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return;
+    }
+    char line[128];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        sscanf(line, "syscr: %llu", &usage->syscr);
+        sscanf(line, "syscw: %llu", &usage->syscw);
+    }
+    fclose(file);
+}
+
+static pid_t wait_with_usage(pid_t pid, int* wstatus, ProcessUsage* usage) {
+    siginfo_t info;
+    while (waitid(P_PID, pid, &info, WEXITED | WNOWAIT) == -1) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/io", (int) pid);
+    read_proc_io(path, usage);
+    return wait4(pid, wstatus, 0, &usage->usage);
+}
+
+static void print_usage(const char* who, const ProcessUsage* usage) {
+    const struct rusage* ru = &usage->usage;
+    printf("%s rusage: user %.3lf s, sys %.3lf s, syscalls %llu read + %llu write, "
+           "context switches %ld voluntary + %ld involuntary\n", who,
+           ru->ru_utime.tv_sec + ru->ru_utime.tv_usec / 1e6, ru->ru_stime.tv_sec + ru->ru_stime.tv_usec / 1e6,
+           usage->syscr, usage->syscw, ru->ru_nvcsw, ru->ru_nivcsw);
+}
+
+// Пакетный режим: ./parent [-m splice|write|epoll] [-r random|rr] [-s seed]
+//                          [-o rebalance|shed] [-q bytes] <file>[:weight] ... < input
+//   На каждый выходной файл - свой ребёнок; строка уходит ребёнку с вероятностью,
+//   пропорциональной весу (по умолчанию 1), или по кругу с учётом весов (-r rr).
+//   splice - отображённый stdin уходит в каналы через vmsplice, каналы увеличены
+//            до BULK_PIPE_SIZE (для неотображаемого stdin - блоки и writev);
+//   write  - прежний путь: по вызову write на каждую строку;
+//   epoll  - неблокирующие каналы и очереди с пределом долга -q на ребёнка;
+//            строки перегруженного ребёнка перераспределяются или отбрасываются (-o);
+//   frame  - строки копятся в пакеты frame.h, пакет уходит по размеру или через -t мс.
+// -l every|sample:N|summary - журнал каждой строки, каждой N-й или только итог.
+// Без файлов запускается диалоговый режим с этими -t и -l.
+static int run_interactive(int flush_ms, unsigned long long log_every);
+
+static int run_bulk(int argc, char* argv[]) {
+    int zero_copy = 1;
+    int use_epoll = 0;
+    int framed = 0;
+    int flush_ms = FRAME_FLUSH_MS;
+    unsigned long long log_every = 0;
+    int shed = 0;
+    size_t queue_limit = BULK_QUEUE_LIMIT;
+    int round_robin = 0;
+    uint64_t seed = (uint64_t) time(NULL) ^ ((uint64_t) getpid() << 32);
+    int bad_usage = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:r:s:o:q:t:l:")) != -1) {
+        if (opt == 'm' && strcmp(optarg, "splice") == 0) {
+            zero_copy = 1;
+            use_epoll = 0;
+            framed = 0;
+        } else if (opt == 'm' && strcmp(optarg, "write") == 0) {
+            zero_copy = 0;
+            use_epoll = 0;
+            framed = 0;
+        } else if (opt == 'm' && strcmp(optarg, "epoll") == 0) {
+            zero_copy = 0;
+            use_epoll = 1;
+            framed = 0;
+        } else if (opt == 'm' && strcmp(optarg, "frame") == 0) {
+            zero_copy = 0;
+            use_epoll = 0;
+            framed = 1;
+        } else if (opt == 't' && strspn(optarg, "0123456789") == strlen(optarg) && strlen(optarg) < 9) {
+            flush_ms = atoi(optarg);
+        } else if (opt == 'l' && strcmp(optarg, "every") == 0) {
+            log_every = 1;
+        } else if (opt == 'l' && strcmp(optarg, "summary") == 0) {
+            log_every = 0;
+        } else if (opt == 'l' && strncmp(optarg, "sample:", 7) == 0 && (log_every = strtoull(optarg + 7, NULL, 10)) > 0) {
+            continue;
+        } else if (opt == 'o' && strcmp(optarg, "rebalance") == 0) {
+            shed = 0;
+        } else if (opt == 'o' && strcmp(optarg, "shed") == 0) {
+            shed = 1;
+        } else if (opt == 'q' && (queue_limit = strtoull(optarg, NULL, 10)) > 0) {
+            continue;
+        } else if (opt == 'r' && strcmp(optarg, "random") == 0) {
+            round_robin = 0;
+        } else if (opt == 'r' && strcmp(optarg, "rr") == 0) {
+            round_robin = 1;
+        } else if (opt == 's') {
+            seed = strtoull(optarg, NULL, 10);
+        } else {
+            bad_usage = 1;
+        }
+    }
+    int count = argc - optind;
+    char** names = argv + optind;
+    if (count == 0 && !bad_usage) {
+        return run_interactive(flush_ms, log_every);
+    }
+    unsigned* weights = malloc(sizeof(unsigned) * (count > 0 ? count : 1));
+    if (weights == NULL) {
+        return IO_ERROR;
+    }
+    // "out.txt:3" - файл out.txt с весом 3; двоеточие без числа - часть имени
+    for (int i = 0; i < count && !bad_usage; i++) {
+        weights[i] = 1;
+        char* colon = strrchr(names[i], ':');
+        if (colon != NULL && colon[1] != '\0' && strspn(colon + 1, "0123456789") == strlen(colon + 1)) {
+            unsigned long weight = strtoul(colon + 1, NULL, 10);
+            if (weight == 0 || weight > 1000000 || colon == names[i]) {
+                bad_usage = 1;
+            }
+            weights[i] = (unsigned) weight;
+            *colon = '\0';
+        }
+    }
+    if (bad_usage || count < 1) {
+        fprintf(stderr, "Использование: %s [-m splice|write|epoll|frame] [-r random|rr] [-s seed] [-o rebalance|shed]"
+                " [-q bytes] [-t ms] [-l every|sample:N|summary] <file>[:weight] ... < input\n", argv[0]);
+        free(weights);
+        return INVALID_INPUT;
+    }
+
+    Workers workers = {0};
+    workers.count = count;
+    workers.zero_copy = zero_copy;
+    workers.batches = calloc(count, sizeof(PipeBatch));
+    pid_t* pids = malloc(sizeof(pid_t) * count);
+    ProcessUsage* usages = calloc(count, sizeof(ProcessUsage));
+    ChildQueue* queues = use_epoll ? calloc(count, sizeof(ChildQueue)) : NULL;
+    if (workers.batches == NULL || pids == NULL || usages == NULL || (use_epoll && queues == NULL) ||
+        router_init(&workers.router, weights, count, round_robin, seed) == -1) {
+        free(workers.batches);
+        free(pids);
+        free(usages);
+        free(queues);
+        free(weights);
+        return IO_ERROR;
+    }
+
+    StatusCode status = STATUS_OK;
+    int started = 0;
+    for (; started < count; started++) {
+        int pipe_fd[2];
+        if (pipe(pipe_fd) == -1) {
+            perror("Ошибка pipe");
+            status = PIPE_ERROR;
+            break;
+        }
+        // Больший канал - меньше переключений между родителем и ребёнком.
+        // Размер задаётся до fork, чтобы ребёнок увидел его через F_GETPIPE_SZ.
+        if ((zero_copy || use_epoll || framed) && fcntl(pipe_fd[1], F_SETPIPE_SZ, BULK_PIPE_SIZE) == -1) {
+            perror("F_SETPIPE_SZ");
+        }
+        pids[started] = fork();
+        if (pids[started] == -1) {
+            perror("Ошибка fork");
+            close(pipe_fd[0]);
+            close(pipe_fd[1]);
+            status = FORK_ERROR;
+            break;
+        }
+        if (pids[started] == 0) {
+            // Ребёнок не должен держать концы записи чужих каналов,
+            // иначе те не получат EOF
+            close(pipe_fd[1]);
+            for (int j = 0; j < started; j++) {
+                close(workers.batches[j].fd);
+            }
+            start_child_process(pipe_fd[0], "./child_run", names[started], framed);
+        }
+        close(pipe_fd[0]);
+        workers.batches[started].fd = pipe_fd[1];
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int rc = 0;
+    struct stat st;
+    char* input = MAP_FAILED;
+    if (status != STATUS_OK) {
+        // Запущены не все дети: данные не отправляем, только дожидаемся запущенных
+    } else if (use_epoll) {
+        rc = bulk_epoll(&workers, queues, queue_limit, shed);
+    } else if (framed) {
+        rc = dispatch_frames(&workers, flush_ms, log_every);
+    } else if (!zero_copy) {
+        rc = bulk_write_lines(&workers);
+    } else if (fstat(STDIN_FILENO, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+               (input = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0)) != MAP_FAILED) {
+        madvise(input, st.st_size, MADV_SEQUENTIAL);
+        int quit = 0;
+        rc = route_lines(&workers, input, st.st_size, 1, &quit) < 0 || flush_all(&workers) == -1 ? -1 : 0;
+    } else {
+        rc = bulk_copy_stream(&workers);
+    }
+    if (rc == -1) {
+        perror("Ошибка с pipe");
+        status = PIPE_ERROR;
+    }
+
+    for (int i = 0; i < started; i++) {
+        close(workers.batches[i].fd);
+    }
+    for (int i = 0; i < started; i++) {
+        int wstatus;
+        if ((wait_with_usage(pids[i], &wstatus, &usages[i]) == -1 || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != STATUS_OK) &&
+            status == STATUS_OK) {
+            status = IO_ERROR;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    // Отображение живёт, пока дети не дочитали переданные им страницы
+    if (input != MAP_FAILED) {
+        munmap(input, st.st_size);
+    }
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    unsigned long long total = 0, total_lines = 0;
+    for (int i = 0; i < started; i++) {
+        total += workers.batches[i].bytes;
+        total_lines += workers.batches[i].lines;
+    }
+    printf("Mode: %s%s, routing: %s\n",
+           use_epoll ? (shed ? "epoll, shed" : "epoll, rebalance") : framed ? "frame" : zero_copy ? "splice" : "write",
+           zero_copy && input == MAP_FAILED ? " (stdin is not a file: writev)" : "",
+           round_robin ? "weighted round-robin" : "weighted random");
+    for (int i = 0; i < started; i++) {
+        const PipeBatch* batch = &workers.batches[i];
+        printf("Worker %d (%s, weight %u): %llu lines (%.1lf%%), %llu bytes", i + 1, names[i], weights[i],
+               batch->lines, total_lines ? 100.0 * batch->lines / total_lines : 0.0, batch->bytes);
+        if (use_epoll) {
+            printf(", taken over %llu, dropped %llu", queues[i].rerouted, queues[i].dropped);
+        }
+        printf("\n");
+    }
+    printf("Time: %lf seconds, %.1lf MB/s\n", seconds, seconds > 0 ? total / seconds / 1e6 : 0.0);
+
+    ProcessUsage own;
+    getrusage(RUSAGE_SELF, &own.usage);
+    read_proc_io("/proc/self/io", &own);
+    print_usage("Parent", &own);
+    for (int i = 0; i < started; i++) {
+        char who[32];
+        snprintf(who, sizeof(who), "Worker %d", i + 1);
+        print_usage(who, &usages[i]);
+    }
+
+    router_free(&workers.router);
+    for (int i = 0; use_epoll && i < count; i++) {
+        free(queues[i].data);
+    }
+    free(queues);
+    free(workers.batches);
+    free(pids);
+    free(usages);
+    free(weights);
+    return status;
+}
+
+// Диалоговый режим: два ребёнка, 80% строк первому и 20% второму
+static int run_interactive(int flush_ms, unsigned long long log_every) {
     // Создаем два канала (pipe) для общения с дочерними процессами
     int pipe1_fd[2];
     int pipe2_fd[2];
@@ -36,7 +1106,7 @@ int main() {
 
     StatusCode status = STATUS_OK;  // Статус выполнения программы
     
-    srand(time(NULL));
+    uint64_t seed = (uint64_t) time(NULL) ^ ((uint64_t) getpid() << 32);
     
     
     const char* str1 = "Введите имя файла для child 1: ";    
@@ -85,7 +1155,7 @@ int main() {
         close(pipe2_fd[0]);  // Закрываем второй канал полностью (не используем)
         close(pipe2_fd[1]);
         
-        start_child_process(pipe1_fd[0], "./child_run", file1_name);
+        start_child_process(pipe1_fd[0], "./child_run", file1_name, 1);
     }
 
     // Создаем второй дочерний процесс 
@@ -103,7 +1173,7 @@ int main() {
         close(pipe1_fd[0]);  // Закрываем первый канал полностью (не используем)
         close(pipe1_fd[1]);
         
-        start_child_process(pipe2_fd[0], "./child_run", file2_name);
+        start_child_process(pipe2_fd[0], "./child_run", file2_name, 1);
     }
 
     // Родительский процесс настраивает свои каналы ===
@@ -118,46 +1188,17 @@ int main() {
     write(STDOUT_FILENO, "Введите строчки \n", strlen(input_str));
     fflush(stdout);
 
-    // Обрабатываем ввод пользователя 
-    char buffer[MAX_LINE_LENGTH];
-    while (fgets(buffer, sizeof(buffer), stdin) != NULL) {
-        int len = strlen(buffer);
-        if (len > 0 && buffer[len - 1] == '\n') {
-            buffer[len - 1] = '\0';
-            len--;
-        }
-        if (strcmp(buffer, "QUIT") == 0) {
-            break;  // Выходим из цикла
-        }
-        
-        int write_fd = -1;  // Переменная для хранения дескриптора канала
-        
-        int random_percent = rand() % 100;  
-        
-        if (random_percent < 80) {
-            write_fd = pipe1_fd[1];
-            int n = snprintf(temp_buffer, sizeof(temp_buffer), "Отправлено в Child 1 (вероятность: %d%%)\n", random_percent);
-            write(STDOUT_FILENO, temp_buffer, n);
-        } else {
-            write_fd = pipe2_fd[1];
-            int n = snprintf(temp_buffer, sizeof(temp_buffer), "Отправлено в Child 2 (вероятность: %d%%)\n", random_percent);
-            write(STDOUT_FILENO, temp_buffer, n);
-        }
-        fflush(stdout);  // Принудительно выводим буфер
-        
-        // Восстанавливаем символ новой строки для корректной передачи
-        if (len < sizeof(buffer) - 1) {
-            buffer[len] = '\n';
-            buffer[len + 1] = '\0';
-            len++;
-        }
-        
-        // Отправляем строку в выбранный канал
-        if (write(write_fd, buffer, len) != len) {
-            perror("Ошибка с pipe"); 
-            return PIPE_ERROR;      
-        }
+    // Обрабатываем ввод пользователя: строки уходят детям пакетами,
+    // задержка строки не больше flush_ms
+    PipeBatch batches[2] = { { .fd = pipe1_fd[1] }, { .fd = pipe2_fd[1] } };
+    unsigned weights[2] = { 80, 20 };
+    Workers workers = { .count = 2, .batches = batches };
+    if (router_init(&workers.router, weights, 2, 0, seed) == -1 ||
+        dispatch_frames(&workers, flush_ms, log_every) == -1) {
+        perror("Ошибка с pipe");
+        status = PIPE_ERROR;
     }
+    router_free(&workers.router);
     
     // Закрываем каналы для записи - это сигнал детям, что данных больше не будет
     close(pipe1_fd[1]);
@@ -166,6 +1207,13 @@ int main() {
     // Ждем завершения обоих дочерних процессов
     waitpid(pid_1, NULL, 0);
     waitpid(pid_2, NULL, 0);
+    if (status != STATUS_OK) {
+        return status;
+    }
+    
+    int n = snprintf(temp_buffer, sizeof(temp_buffer), "Отправлено в Child 1: %llu строк, в Child 2: %llu строк\n",
+                     batches[0].lines, batches[1].lines);
+    write(STDOUT_FILENO, temp_buffer, n);
     
     const char* end_msg = "Родительский и детский процесс успешно завершены\n";
     write(STDOUT_FILENO, "Родительский и детский процесс успешно завершены\n", strlen(end_msg));
@@ -179,4 +1227,12 @@ cleanup_pipes:
     close(pipe1_fd[0]); close(pipe1_fd[1]);
     close(pipe2_fd[0]); close(pipe2_fd[1]);
     return status;
-}
\ No newline at end of file
+}
+
+int main(int argc, char* argv[]) {
+    // С аргументами - пакетный режим для больших объёмов
+    if (argc > 1) {
+        return run_bulk(argc, argv);
+    }
+    return run_interactive(FRAME_FLUSH_MS, 1);
+}
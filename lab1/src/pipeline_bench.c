@@ -0,0 +1,431 @@
+// Сквозной замер конвейера parent -> child_run.
+//   gcc -O2 -pthread -o pipeline_bench pipeline_bench.c -lm
+//   ./pipeline_bench [-n lines] [-d fixed:N|uniform:MIN:MAX|exp:MEAN] [-S seed] [-R lines/s]
+//                    [-w 80,20] [-- parent options]
+// Запускается из каталога, где лежат ./parent и ./child_run. Строки генерируются
+// с фиксированным зерном, поэтому два прогона на разных ревизиях получают один
+// и тот же вход. Выходы детей - именованные каналы, которые читает сам замер.
+//
+// Каждая строка начинается с метки "SSSSSSSSSS TTTTTTTTTTTTTTTTTTT ": номер строки
+// и CLOCK_MONOTONIC в наносекундах на момент генерации. Цифры и пробел не гласные,
+// ребёнок их не трогает, поэтому по выходной строке видно, сколько она шла.
+// Распределение -d задаёт длину части после метки.
+#define _GNU_SOURCE
+#include "os_utils.h"
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define STAMP_LENGTH 31                 // 10 цифр номера, пробел, 19 цифр времени, пробел
+#define WRITE_CHUNK (64 * 1024)         // Порция записи в stdin родителя
+#define READ_CHUNK (1024 * 1024)
+#define TEXT_POOL_SIZE (1024 * 1024)    // Случайный текст, из которого берутся строки
+#define MAX_WORKERS 64
+#define NO_LATENCY UINT32_MAX
+
+typedef enum { DIST_FIXED, DIST_UNIFORM, DIST_EXP } Distribution;
+
+typedef struct {
+    Distribution kind;
+    unsigned a, b;      // fixed: a; uniform: [a, b]; exp: среднее a
+} LengthSpec;
+
+typedef struct {
+    char path[256];
+    uint32_t* latency_us;   // Задержка по номеру строки, общая для всех читателей
+    unsigned long long lines_count;
+    unsigned long long bytes;
+    unsigned long long corrupt;
+} Reader;
+
+static uint64_t xorshift64(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static unsigned next_length(const LengthSpec* spec, uint64_t* rng) {
+    switch (spec->kind) {
+        case DIST_UNIFORM:
+            return spec->a + (unsigned) (xorshift64(rng) % (spec->b - spec->a + 1));
+        case DIST_EXP: {
+            // Длинный хвост ограничен, чтобы строка помещалась в пул текста
+            double u = ((xorshift64(rng) >> 11) + 1) * (1.0 / 9007199254740993.0);
+            double len = -log(u) * spec->a;
+            return len > TEXT_POOL_SIZE / 2 ? TEXT_POOL_SIZE / 2 : (unsigned) len;
+        }
+        default:
+            return spec->a;
+    }
+}
+
+static int parse_lengths(const char* arg, LengthSpec* spec) {
+    char tail;
+    if (sscanf(arg, "fixed:%u%c", &spec->a, &tail) == 1) {
+        spec->kind = DIST_FIXED;
+        return spec->a <= TEXT_POOL_SIZE / 2 ? 0 : -1;
+    }
+    if (sscanf(arg, "uniform:%u:%u%c", &spec->a, &spec->b, &tail) == 2) {
+        spec->kind = DIST_UNIFORM;
+        return spec->a <= spec->b && spec->b <= TEXT_POOL_SIZE / 2 ? 0 : -1;
+    }
+    if (sscanf(arg, "exp:%u%c", &spec->a, &tail) == 1) {
+        spec->kind = DIST_EXP;
+        return spec->a > 0 ? 0 : -1;
+    }
+    return -1;
+}
+
+static void put_digits(char* out, uint64_t value, int width) {
+    for (int i = width - 1; i >= 0; i--) {
+        out[i] = (char) ('0' + value % 10);
+        value /= 10;
+    }
+}
+
+static uint64_t get_digits(const char* in, int width, int* ok) {
+    uint64_t value = 0;
+    for (int i = 0; i < width; i++) {
+        if (in[i] < '0' || in[i] > '9') {
+            *ok = 0;
+        }
+        value = value * 10 + (uint64_t) (in[i] - '0');
+    }
+    return value;
+}
+
+static void account_line(Reader* reader, const char* line, size_t len, uint64_t arrived, unsigned long long total) {
+    int ok = len >= STAMP_LENGTH - 1 && line[10] == ' ';
+    uint64_t seq = ok ? get_digits(line, 10, &ok) : 0;
+    uint64_t sent = ok ? get_digits(line + 11, 19, &ok) : 0;
+    if (!ok || seq >= total || sent > arrived) {
+        reader->corrupt++;
+        return;
+    }
+    uint64_t us = (arrived - sent) / 1000;
+    reader->latency_us[seq] = us >= NO_LATENCY ? NO_LATENCY - 1 : (uint32_t) us;
+    reader->lines_count++;
+}
+
+// Поток на выход каждого ребёнка: open блокируется, пока ребёнок не откроет канал
+static unsigned long long total_lines;
+
+static void* reader_main(void* arg) {
+    Reader* reader = arg;
+    int fd = open(reader->path, O_RDONLY);
+    if (fd == -1) {
+        perror(reader->path);
+        return NULL;
+    }
+    char* buffer = malloc(READ_CHUNK);
+    size_t filled = 0, capacity = READ_CHUNK;
+    for (;;) {
+        if (filled == capacity) {
+            char* grown = realloc(buffer, capacity * 2);
+            if (grown == NULL) {
+                break;
+            }
+            buffer = grown;
+            capacity *= 2;
+        }
+        ssize_t n = read(fd, buffer + filled, capacity - filled);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        // Все строки одной порции пришли в один момент
+        uint64_t arrived = now_ns();
+        reader->bytes += n;
+        filled += n;
+        size_t pos = 0;
+        const char* end;
+        while ((end = memchr(buffer + pos, '\n', filled - pos)) != NULL) {
+            account_line(reader, buffer + pos, end - (buffer + pos), arrived, total_lines);
+            pos = end - buffer + 1;
+        }
+        memmove(buffer, buffer + pos, filled - pos);
+        filled -= pos;
+    }
+    if (filled > 0) {
+        reader->corrupt++;
+    }
+    free(buffer);
+    close(fd);
+    return NULL;
+}
+
+static int write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Генерация и отправка строк; при rate > 0 строка i уходит не раньше start + i / rate
+static int feed_lines(int fd, unsigned long long lines, const LengthSpec* spec, uint64_t seed, double rate,
+                      unsigned long long* bytes) {
+    uint64_t rng = seed ? seed : 0x9E3779B97F4A7C15ull;
+    char* pool = malloc(TEXT_POOL_SIZE);
+    size_t capacity = WRITE_CHUNK + STAMP_LENGTH + TEXT_POOL_SIZE / 2 + 1;
+    char* chunk = malloc(capacity);
+    if (pool == NULL || chunk == NULL) {
+        free(pool);
+        free(chunk);
+        return -1;
+    }
+    // Буквы вперемешку, примерно треть из них - гласные
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyzAEIOUaeiouy      ";
+    for (size_t i = 0; i < TEXT_POOL_SIZE; i++) {
+        pool[i] = letters[xorshift64(&rng) % (sizeof(letters) - 1)];
+    }
+
+    int status = 0;
+    size_t filled = 0;
+    uint64_t start = now_ns();
+    for (unsigned long long seq = 0; seq < lines && status == 0; seq++) {
+        unsigned len = next_length(spec, &rng);
+        if (rate > 0) {
+            uint64_t due = start + (uint64_t) (seq * 1e9 / rate);
+            uint64_t now = now_ns();
+            if (due > now) {
+                // Накопленное уходит до сна, иначе оно ждало бы вместе с этой строкой
+                status = write_all(fd, chunk, filled);
+                filled = 0;
+                struct timespec pause = { (time_t) ((due - now) / 1000000000ull), (long) ((due - now) % 1000000000ull) };
+                nanosleep(&pause, NULL);
+            }
+        }
+        char* line = chunk + filled;
+        put_digits(line, seq, 10);
+        line[10] = ' ';
+        put_digits(line + 11, now_ns(), 19);
+        line[30] = ' ';
+        memcpy(line + STAMP_LENGTH, pool + xorshift64(&rng) % (TEXT_POOL_SIZE - len), len);
+        line[STAMP_LENGTH + len] = '\n';
+        filled += STAMP_LENGTH + len + 1;
+        *bytes += STAMP_LENGTH + len + 1;
+        if (filled >= WRITE_CHUNK) {
+            status = write_all(fd, chunk, filled);
+            filled = 0;
+        }
+    }
+    if (status == 0) {
+        status = write_all(fd, chunk, filled);
+    }
+    free(pool);
+    free(chunk);
+    return status;
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*) a, y = *(const uint32_t*) b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long long lines = 1000000;
+    LengthSpec spec = { DIST_UNIFORM, 0, 120 };
+    uint64_t seed = 1;
+    double rate = 0;
+    unsigned weights[MAX_WORKERS] = { 80, 20 };
+    int workers = 2;
+    int bad_usage = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:d:S:R:w:")) != -1) {
+        if (opt == 'n' && (lines = strtoull(optarg, NULL, 10)) > 0 && lines < 10000000000ull) {
+            continue;
+        } else if (opt == 'd' && parse_lengths(optarg, &spec) == 0) {
+            continue;
+        } else if (opt == 'S') {
+            seed = strtoull(optarg, NULL, 10);
+        } else if (opt == 'R' && (rate = atof(optarg)) >= 0) {
+            continue;
+        } else if (opt == 'w') {
+            workers = 0;
+            for (char* item = strtok(optarg, ","); item != NULL && workers < MAX_WORKERS; item = strtok(NULL, ",")) {
+                weights[workers] = (unsigned) strtoul(item, NULL, 10);
+                bad_usage |= weights[workers++] == 0;
+            }
+            bad_usage |= workers == 0;
+        } else {
+            bad_usage = 1;
+        }
+    }
+    if (bad_usage) {
+        fprintf(stderr, "Использование: %s [-n lines] [-d fixed:N|uniform:MIN:MAX|exp:MEAN] [-S seed] [-R lines/s]"
+                " [-w 80,20] [-- parent options]\n", argv[0]);
+        return INVALID_INPUT;
+    }
+    total_lines = lines;
+
+    char dir[] = "/tmp/lab1_bench.XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        perror("mkdtemp");
+        return IO_ERROR;
+    }
+    Reader readers[MAX_WORKERS];
+    uint32_t* latency = malloc(sizeof(uint32_t) * lines);
+    if (latency == NULL) {
+        rmdir(dir);
+        return IO_ERROR;
+    }
+    memset(latency, 0xff, sizeof(uint32_t) * lines);
+
+    // Аргументы parent: его опции после "--" и каналы с весами
+    int parent_opts = argc - optind;
+    char** parent_argv = calloc(parent_opts + workers + 2, sizeof(char*));
+    char (*targets)[300] = calloc(workers, sizeof(*targets));
+    parent_argv[0] = "./parent";
+    for (int i = 0; i < parent_opts; i++) {
+        parent_argv[1 + i] = argv[optind + i];
+    }
+    StatusCode status = STATUS_OK;
+    for (int i = 0; i < workers; i++) {
+        memset(&readers[i], 0, sizeof(Reader));
+        snprintf(readers[i].path, sizeof(readers[i].path), "%s/out%d", dir, i + 1);
+        readers[i].latency_us = latency;
+        if (mkfifo(readers[i].path, 0600) == -1) {
+            perror("mkfifo");
+            status = IO_ERROR;
+        }
+        snprintf(targets[i], sizeof(targets[i]), "%.255s:%u", readers[i].path, weights[i]);
+        parent_argv[1 + parent_opts + i] = targets[i];
+    }
+
+    // Отчёт родителя - во временный файл: канал мог бы переполниться и остановить его
+    char report_path[300];
+    snprintf(report_path, sizeof(report_path), "%s/report.txt", dir);
+    int report_fd = open(report_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    int input[2];
+    if (status != STATUS_OK || report_fd == -1 || pipe(input) == -1) {
+        perror("Ошибка подготовки");
+        return IO_ERROR;
+    }
+
+    uint64_t start = now_ns();
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("Ошибка fork");
+        return FORK_ERROR;
+    }
+    if (pid == 0) {
+        dup2(input[0], STDIN_FILENO);
+        dup2(report_fd, STDOUT_FILENO);
+        close(input[0]);
+        close(input[1]);
+        close(report_fd);
+        execv(parent_argv[0], parent_argv);
+        perror("Ошибка exec ./parent");
+        _exit(EXEC_ERROR);
+    }
+    close(input[0]);
+
+    pthread_t threads[MAX_WORKERS];
+    for (int i = 0; i < workers; i++) {
+        pthread_create(&threads[i], NULL, reader_main, &readers[i]);
+    }
+    unsigned long long bytes = 0;
+    if (feed_lines(input[1], lines, &spec, seed, rate, &bytes) == -1) {
+        perror("Ошибка записи в parent");
+        status = PIPE_ERROR;
+    }
+    close(input[1]);
+
+    int wstatus = 0;
+    struct rusage parent_usage;
+    wait4(pid, &wstatus, 0, &parent_usage);
+    if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != STATUS_OK) {
+        fprintf(stderr, "parent завершился с ошибкой\n");
+        status = IO_ERROR;
+        // Дети могли не открыть каналы: открываем сами, чтобы читатели получили EOF
+        for (int i = 0; i < workers; i++) {
+            int fd = open(readers[i].path, O_WRONLY | O_NONBLOCK);
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+    }
+    for (int i = 0; i < workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double seconds = (now_ns() - start) / 1e9;
+
+    unsigned long long received = 0, corrupt = 0, out_bytes = 0;
+    for (int i = 0; i < workers; i++) {
+        received += readers[i].lines_count;
+        corrupt += readers[i].corrupt;
+        out_bytes += readers[i].bytes;
+    }
+    // Недошедшие строки (например, отброшенные -o shed) остаются NO_LATENCY и уходят в конец
+    qsort(latency, lines, sizeof(uint32_t), compare_u32);
+
+    printf("Workload: %llu lines, %llu bytes, lengths %s%u", lines, bytes,
+           spec.kind == DIST_FIXED ? "fixed:" : spec.kind == DIST_UNIFORM ? "uniform:" : "exp:", spec.a);
+    if (spec.kind == DIST_UNIFORM) {
+        printf(":%u", spec.b);
+    }
+    printf(" + %d stamp, seed %llu, ", STAMP_LENGTH, (unsigned long long) seed);
+    if (rate > 0) {
+        printf("rate %.0lf lines/s\n", rate);
+    } else {
+        printf("rate unlimited\n");
+    }
+    printf("Delivered: %llu lines (%llu missing, %llu corrupt), %llu bytes after filtering\n", received,
+           lines - received, corrupt, out_bytes);
+    printf("Throughput: %.0lf lines/s, %.1lf MB/s in %.3lf s\n", lines / seconds, bytes / seconds / 1e6, seconds);
+    if (received > 0) {
+        static const double percentiles[] = { 50, 90, 99, 99.9 };
+        printf("Latency us:");
+        for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+            printf(" p%g %u", percentiles[i], latency[(size_t) ((received - 1) * percentiles[i] / 100)]);
+        }
+        printf(" max %u\n", latency[received - 1]);
+    }
+
+    // Сводка самого parent, в том числе rusage его и каждого ребёнка
+    lseek(report_fd, 0, SEEK_SET);
+    FILE* report = fdopen(report_fd, "r");
+    char line[512];
+    while (report != NULL && fgets(line, sizeof(line), report) != NULL) {
+        printf("parent> %s", line);
+    }
+    printf("Parent tree rusage: user %.3lf s, sys %.3lf s, context switches %ld voluntary + %ld involuntary\n",
+           parent_usage.ru_utime.tv_sec + parent_usage.ru_utime.tv_usec / 1e6,
+           parent_usage.ru_stime.tv_sec + parent_usage.ru_stime.tv_usec / 1e6,
+           parent_usage.ru_nvcsw, parent_usage.ru_nivcsw);
+    if (report != NULL) {
+        fclose(report);
+    }
+
+    for (int i = 0; i < workers; i++) {
+        unlink(readers[i].path);
+    }
+    unlink(report_path);
+    rmdir(dir);
+    free(targets);
+    free(parent_argv);
+    free(latency);
+    return status;
+}
@@ -0,0 +1,256 @@
+#include "aho_corasick.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Временный бор для построения: дети хранятся списком братьев
+typedef struct {
+    int first_child;
+    int next_sibling;
+    int first_pattern;   // Список образцов, оканчивающихся в узле (через pattern_next)
+    uint8_t label;
+} TrieNode;
+
+typedef struct {
+    TrieNode *nodes;
+    int count;
+    int capacity;
+} Trie;
+
+static int trie_new_node(Trie *trie, uint8_t label) {
+    if (trie->count == trie->capacity) {
+        int new_capacity = trie->capacity ? trie->capacity * 2 : 1024;
+        TrieNode *grown = realloc(trie->nodes, sizeof(TrieNode) * new_capacity);
+        if (!grown) return -1;
+        trie->nodes = grown;
+        trie->capacity = new_capacity;
+    }
+    TrieNode *node = &trie->nodes[trie->count];
+    node->first_child = -1;
+    node->next_sibling = -1;
+    node->first_pattern = -1;
+    node->label = label;
+    return trie->count++;
+}
+
+static int trie_child(const Trie *trie, int node, uint8_t label) {
+    for (int c = trie->nodes[node].first_child; c != -1; c = trie->nodes[c].next_sibling) {
+        if (trie->nodes[c].label == label) return c;
+    }
+    return -1;
+}
+
+static int compare_edges(const void *a, const void *b) {
+    const int64_t *x = a, *y = b;
+    return (*x > *y) - (*x < *y);
+}
+
+// Переход из состояния s по символу c с учётом суффиксных ссылок
+static inline int32_t ac_next(const AhoCorasick *ac, int32_t s, uint8_t c) {
+    while (s >= ac->dense_count) {
+        int32_t lo = ac->edge_start[s];
+        int32_t hi = ac->edge_start[s + 1];
+        // У глубоких состояний обычно одно-два ребра, линейный просмотр быстрее бинарного
+        for (int32_t e = lo; e < hi; e++) {
+            if (ac->edge_label[e] == c) return ac->edge_target[e];
+            if (ac->edge_label[e] > c) break;
+        }
+        s = ac->fail[s];
+    }
+    return ac->dense[(size_t)s * 256 + c];
+}
+
+void ac_free(AhoCorasick *ac) {
+    if (!ac) return;
+    free(ac->dense);
+    free(ac->fail);
+    free(ac->edge_start);
+    free(ac->edge_label);
+    free(ac->edge_target);
+    free(ac->out_start);
+    free(ac->out_ids);
+    free(ac->out_link);
+    free(ac->pattern_len);
+    free(ac);
+}
+
+AhoCorasick *ac_build(const char *const *patterns, const int *lengths, int count) {
+    if (count <= 0) return NULL;
+
+    Trie trie = {0};
+    int *pattern_next = malloc(sizeof(int) * count);
+    AhoCorasick *ac = calloc(1, sizeof(AhoCorasick));
+    int *order = NULL, *new_id = NULL;
+    int64_t *edges = NULL;
+    if (!pattern_next || !ac || trie_new_node(&trie, 0) != 0) goto fail;
+
+    ac->pattern_count = count;
+    ac->pattern_len = malloc(sizeof(int) * count);
+    if (!ac->pattern_len) goto fail;
+    ac->min_len = lengths[0];
+    ac->max_len = lengths[0];
+
+    // 1. Бор из всех образцов
+    for (int p = 0; p < count; p++) {
+        if (lengths[p] <= 0) goto fail;
+        int node = 0;
+        for (int i = 0; i < lengths[p]; i++) {
+            uint8_t c = (uint8_t)patterns[p][i];
+            int child = trie_child(&trie, node, c);
+            if (child == -1) {
+                child = trie_new_node(&trie, c);
+                if (child == -1) goto fail;
+                trie.nodes[child].next_sibling = trie.nodes[node].first_child;
+                trie.nodes[node].first_child = child;
+            }
+            node = child;
+        }
+        pattern_next[p] = trie.nodes[node].first_pattern;
+        trie.nodes[node].first_pattern = p;
+        ac->pattern_len[p] = lengths[p];
+        if (lengths[p] < ac->min_len) ac->min_len = lengths[p];
+        if (lengths[p] > ac->max_len) ac->max_len = lengths[p];
+    }
+
+    // 2. Перенумерация в порядке обхода в ширину
+    int n = trie.count;
+    order = malloc(sizeof(int) * n);
+    new_id = malloc(sizeof(int) * n);
+    if (!order || !new_id) goto fail;
+    int head = 0, tail = 0;
+    order[tail++] = 0;
+    new_id[0] = 0;
+    while (head < tail) {
+        int node = order[head++];
+        for (int c = trie.nodes[node].first_child; c != -1; c = trie.nodes[c].next_sibling) {
+            new_id[c] = tail;
+            order[tail++] = c;
+        }
+    }
+
+    ac->state_count = n;
+    ac->dense_count = n < AC_DENSE_STATES ? n : AC_DENSE_STATES;
+    ac->dense = malloc(sizeof(int32_t) * 256 * (size_t)ac->dense_count);
+    ac->fail = malloc(sizeof(int32_t) * n);
+    ac->edge_start = malloc(sizeof(int32_t) * (n + 1));
+    ac->edge_label = malloc(n > 1 ? n - 1 : 1);
+    ac->edge_target = malloc(sizeof(int32_t) * (n > 1 ? n - 1 : 1));
+    ac->out_start = malloc(sizeof(int32_t) * (n + 1));
+    ac->out_ids = malloc(sizeof(int32_t) * count);
+    ac->out_link = malloc(sizeof(int32_t) * n);
+    edges = malloc(sizeof(int64_t) * 256);
+    if (!ac->dense || !ac->fail || !ac->edge_start || !ac->edge_label ||
+        !ac->edge_target || !ac->out_start || !ac->out_ids || !ac->out_link || !edges) {
+        goto fail;
+    }
+
+    // 3. Рёбра (по возрастанию символа) и выходы в новой нумерации
+    int edge_pos = 0, out_pos = 0;
+    for (int s = 0; s < n; s++) {
+        int node = order[s];
+        int degree = 0;
+        for (int c = trie.nodes[node].first_child; c != -1; c = trie.nodes[c].next_sibling) {
+            edges[degree++] = ((int64_t)trie.nodes[c].label << 32) | (uint32_t)new_id[c];
+        }
+        qsort(edges, degree, sizeof(int64_t), compare_edges);
+        ac->edge_start[s] = edge_pos;
+        for (int e = 0; e < degree; e++) {
+            ac->edge_label[edge_pos] = (uint8_t)(edges[e] >> 32);
+            ac->edge_target[edge_pos] = (int32_t)(edges[e] & 0xffffffff);
+            edge_pos++;
+        }
+        ac->out_start[s] = out_pos;
+        for (int p = trie.nodes[node].first_pattern; p != -1; p = pattern_next[p]) {
+            ac->out_ids[out_pos++] = p;
+        }
+    }
+    ac->edge_start[n] = edge_pos;
+    ac->out_start[n] = out_pos;
+
+    // 4. Суффиксные ссылки и плотные строки в порядке BFS:
+    // fail[s] всегда меньше s, поэтому всё нужное уже посчитано
+    ac->fail[0] = 0;
+    ac->out_link[0] = -1;
+    for (int s = 0; s < n; s++) {
+        if (s < ac->dense_count) {
+            int32_t *row = &ac->dense[(size_t)s * 256];
+            if (s == 0) {
+                for (int c = 0; c < 256; c++) row[c] = 0;
+            } else {
+                memcpy(row, &ac->dense[(size_t)ac->fail[s] * 256], sizeof(int32_t) * 256);
+            }
+            for (int32_t e = ac->edge_start[s]; e < ac->edge_start[s + 1]; e++) {
+                row[ac->edge_label[e]] = ac->edge_target[e];
+            }
+        }
+        for (int32_t e = ac->edge_start[s]; e < ac->edge_start[s + 1]; e++) {
+            int32_t child = ac->edge_target[e];
+            int32_t f = (s == 0) ? 0 : ac_next(ac, ac->fail[s], ac->edge_label[e]);
+            ac->fail[child] = f;
+            ac->out_link[child] = (ac->out_start[f + 1] > ac->out_start[f]) ? f : ac->out_link[f];
+        }
+    }
+
+    free(edges);
+    free(order);
+    free(new_id);
+    free(pattern_next);
+    free(trie.nodes);
+    return ac;
+
+fail:
+    free(edges);
+    free(order);
+    free(new_id);
+    free(pattern_next);
+    free(trie.nodes);
+    ac_free(ac);
+    return NULL;
+}
+
+int ac_match_list_push(AcMatchList *list, int pattern_id, size_t offset) {
+    if (list->count == list->capacity) {
+        size_t new_capacity = list->capacity ? list->capacity * 2 : 256;
+        AcMatch *grown = realloc(list->items, sizeof(AcMatch) * new_capacity);
+        if (!grown) return -1;
+        list->items = grown;
+        list->capacity = new_capacity;
+    }
+    list->items[list->count].pattern_id = pattern_id;
+    list->items[list->count].offset = offset;
+    list->count++;
+    return 0;
+}
+
+int ac_search(const AhoCorasick *ac, const char *text, size_t start, size_t end, size_t own_end,
+              AcMatchList *out) {
+    const uint8_t *t = (const uint8_t *)text;
+    int32_t s = 0;
+    for (size_t i = start; i < end; i++) {
+        s = ac_next(ac, s, t[i]);
+        // Перебираем все образцы, оканчивающиеся в позиции i
+        for (int32_t v = (ac->out_start[s + 1] > ac->out_start[s]) ? s : ac->out_link[s];
+             v != -1; v = ac->out_link[v]) {
+            for (int32_t k = ac->out_start[v]; k < ac->out_start[v + 1]; k++) {
+                int id = ac->out_ids[k];
+                size_t offset = i + 1 - ac->pattern_len[id];
+                if (offset >= own_end) {
+                    continue;
+                }
+                if (match_control_cancelled(&out->control)) {
+                    return 0;
+                }
+                if (out->control.mode == MATCH_COUNT) {
+                    out->count++;
+                    continue;
+                }
+                if (ac_match_list_push(out, id, offset) != 0) {
+                    return -1;
+                }
+                if (out->control.mode == MATCH_EXISTS) {
+                    return 0;
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+#ifndef AHO_CORASICK_H
+#define AHO_CORASICK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "search_kernels.h"
+
+// Сколько первых (в порядке BFS) состояний получают плотную строку переходов.
+// 256 строк * 256 * 4 байта = 256 КБ - помещается в L2
+#define AC_DENSE_STATES 256
+
+// Автомат Ахо–Корасик. Состояния пронумерованы в порядке обхода в ширину,
+// поэтому "горячие" неглубокие состояния лежат рядом и имеют плотные строки
+// (полная функция переходов), а остальные хранят только рёбра бора,
+// отсортированные по символу, и суффиксную ссылку.
+typedef struct {
+    int state_count;
+    int dense_count;
+    int32_t *dense;         // dense_count * 256 переходов
+    int32_t *fail;          // Суффиксная ссылка
+    int32_t *edge_start;    // Рёбра состояния s: [edge_start[s], edge_start[s + 1])
+    uint8_t *edge_label;
+    int32_t *edge_target;
+    int32_t *out_start;     // Образцы, оканчивающиеся в s: out_ids[out_start[s] .. out_start[s + 1])
+    int32_t *out_ids;
+    int32_t *out_link;      // Ближайшее по суффиксным ссылкам состояние с выходом (-1 если нет)
+    int pattern_count;
+    int *pattern_len;
+    int min_len;
+    int max_len;
+} AhoCorasick;
+
+typedef struct {
+    int pattern_id;
+    size_t offset;
+} AcMatch;
+
+// control: MATCH_COUNT не хранит пары, MATCH_EXISTS останавливается на первой.
+// Для MATCH_FIRST_K кусок собирается целиком: автомат находит вхождения
+// по позиции конца, и раньше конца куска наименьшие начала не известны.
+typedef struct {
+    AcMatch *items;
+    size_t count;
+    size_t capacity;
+    MatchControl control;
+} AcMatchList;
+
+// Построение автомата по массиву образцов. Возвращает NULL при ошибке.
+AhoCorasick *ac_build(const char *const *patterns, const int *lengths, int count);
+void ac_free(AhoCorasick *ac);
+
+// Поиск всех образцов в text[start, end) за один проход.
+// Сохраняются только вхождения, начинающиеся до own_end (остальное - перекрытие
+// со следующим куском). Возвращает -1 при нехватке памяти.
+// Досрочная остановка по out->control не считается ошибкой.
+int ac_search(const AhoCorasick *ac, const char *text, size_t start, size_t end, size_t own_end,
+              AcMatchList *out);
+
+int ac_match_list_push(AcMatchList *list, int pattern_id, size_t offset);
+
+#endif
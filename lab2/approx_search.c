@@ -0,0 +1,182 @@
+#include "approx_search.h"
+#include <stdlib.h>
+#include <string.h>
+
+ApproxPattern *approx_prepare(const char *pattern, size_t pattern_len, int k, ApproxMetric metric) {
+    if (pattern_len == 0 || k < 0 || (size_t)k >= pattern_len) return NULL;
+
+    ApproxPattern *ap = malloc(sizeof(ApproxPattern));
+    if (!ap) return NULL;
+    ap->metric = metric;
+    ap->k = k;
+    ap->pattern_len = pattern_len;
+    ap->words = (int)((pattern_len + 63) / 64);
+    ap->peq = calloc(256 * (size_t)ap->words, sizeof(uint64_t));
+    if (!ap->peq) {
+        free(ap);
+        return NULL;
+    }
+    for (size_t i = 0; i < pattern_len; i++) {
+        unsigned char c = (unsigned char)pattern[i];
+        ap->peq[c * ap->words + i / 64] |= 1ULL << (i % 64);
+    }
+    return ap;
+}
+
+void approx_release(ApproxPattern *ap) {
+    if (!ap) return;
+    free(ap->peq);
+    free(ap);
+}
+
+size_t approx_min_len(const ApproxPattern *ap) {
+    return ap->metric == APPROX_EDIT ? ap->pattern_len - ap->k : ap->pattern_len;
+}
+
+size_t approx_max_len(const ApproxPattern *ap) {
+    return ap->metric == APPROX_EDIT ? ap->pattern_len + ap->k : ap->pattern_len;
+}
+
+// Shift-Or с k + 1 векторами: бит i вектора R[j] равен 0, если префикс
+// образца длины i + 1 совпадает с текстом, оканчивающимся в текущей позиции,
+// не более чем с j заменами. Переход: R[j] = ((R[j] << 1) | ~Eq[c]) & (R[j-1] << 1),
+// где R[j-1] - значение до обработки текущего байта (замена текущего символа).
+static void mismatch_search_one_word(const ApproxPattern *ap, const unsigned char *text, size_t start,
+                                     size_t end, uint64_t *r, MatchBuffer *out) {
+    int k = ap->k;
+    size_t m = ap->pattern_len;
+    uint64_t high = 1ULL << (m - 1);
+    for (int j = 0; j <= k; j++) r[j] = ~0ULL;
+
+    for (size_t pos = start; pos < end; pos++) {
+        uint64_t miss = ~ap->peq[text[pos]];
+        uint64_t prev = r[0];
+        r[0] = (r[0] << 1) | miss;
+        for (int j = 1; j <= k; j++) {
+            uint64_t cur = r[j];
+            r[j] = ((cur << 1) | miss) & (prev << 1);
+            prev = cur;
+        }
+        // Вхождение длины m не может начаться раньше start: первые m - 1 байт
+        // куска лишь заполняют состояние
+        if (!(r[k] & high) && match_buffer_push(out, pos + 1 - m)) return;
+    }
+}
+
+// То же для образцов длиннее 64 байт: сдвиг распространяет перенос между словами
+static void mismatch_search_words(const ApproxPattern *ap, const unsigned char *text, size_t start,
+                                  size_t end, uint64_t *r, MatchBuffer *out) {
+    int k = ap->k;
+    int words = ap->words;
+    size_t m = ap->pattern_len;
+    int high_word = (int)((m - 1) / 64);
+    uint64_t high = 1ULL << ((m - 1) % 64);
+    for (size_t i = 0; i < (size_t)(k + 1) * words; i++) r[i] = ~0ULL;
+
+    for (size_t pos = start; pos < end; pos++) {
+        const uint64_t *eq = ap->peq + (size_t)text[pos] * words;
+        for (int w = words - 1; w >= 0; w--) {
+            // Слово w сдвинутого вектора зависит только от слов w и w - 1,
+            // поэтому, идя от старших слов к младшим, можно обновлять на месте
+            uint64_t prev_shift = ~0ULL;   // Сдвинутый R[j-1] до обновления; для R[0] не ограничивает
+            for (int j = 0; j <= k; j++) {
+                uint64_t *row = r + (size_t)j * words;
+                uint64_t carry = w > 0 ? row[w - 1] >> 63 : 0;
+                uint64_t shifted = (row[w] << 1) | carry;
+                row[w] = (shifted | ~eq[w]) & prev_shift;
+                prev_shift = shifted;
+            }
+        }
+        if (!(r[(size_t)k * words + high_word] & high) && match_buffer_push(out, pos + 1 - m)) return;
+    }
+}
+
+// Один блок алгоритма Майерса в варианте Хиро для нескольких слов.
+// Pv/Mv - положительные и отрицательные вертикальные разности столбца матрицы
+// расстояний, hin - горизонтальная разность, пришедшая из блока выше.
+// Возвращает горизонтальную разность в строке, отмеченной high.
+static inline int myers_advance(uint64_t *pv_io, uint64_t *mv_io, uint64_t eq, int hin, uint64_t high) {
+    uint64_t pv = *pv_io, mv = *mv_io;
+    uint64_t hin_neg = hin < 0 ? 1 : 0;
+    uint64_t xv = eq | mv;
+    eq |= hin_neg;
+    uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+    uint64_t ph = mv | ~(xh | pv);
+    uint64_t mh = pv & xh;
+    int hout = (ph & high) ? 1 : (mh & high) ? -1 : 0;
+    ph <<= 1;
+    mh <<= 1;
+    mh |= hin_neg;
+    ph |= hin > 0 ? 1 : 0;
+    *pv_io = mh | ~(xv | ph);
+    *mv_io = ph & xv;
+    return hout;
+}
+
+static void edit_search(const ApproxPattern *ap, const unsigned char *text, size_t scan_from,
+                        size_t first_end, size_t end, uint64_t *state, MatchBuffer *out) {
+    int k = ap->k;
+    int words = ap->words;
+    size_t m = ap->pattern_len;
+    uint64_t *pv = state;
+    uint64_t *mv = state + words;
+    uint64_t last_high = 1ULL << ((m - 1) % 64);
+    // Верхняя строка матрицы нулевая (вхождение может начаться где угодно),
+    // нижняя в начале равна m
+    size_t score = m;
+    for (int w = 0; w < words; w++) {
+        pv[w] = ~0ULL;
+        mv[w] = 0;
+    }
+
+    for (size_t pos = scan_from; pos < end; pos++) {
+        const uint64_t *eq = ap->peq + (size_t)text[pos] * words;
+        int carry = 0;
+        for (int w = 0; w < words - 1; w++) {
+            carry = myers_advance(&pv[w], &mv[w], eq[w], carry, 1ULL << 63);
+        }
+        // В последнем блоке разность берётся в строке m; строки-заполнители
+        // выше неё на результат не влияют, перенос идёт только вверх по битам
+        carry = myers_advance(&pv[words - 1], &mv[words - 1], eq[words - 1], carry, last_high);
+        score += carry;
+        if (pos >= first_end && score <= (size_t)k && match_buffer_push(out, pos)) return;
+    }
+}
+
+void approx_search(const ApproxPattern *ap, const char *text, size_t start, size_t own_end,
+                   MatchBuffer *out) {
+    if (start >= own_end) return;
+    const unsigned char *t = (const unsigned char *)text;
+    size_t words = (size_t)ap->words;
+
+    if (ap->metric == APPROX_MISMATCH) {
+        uint64_t *r = malloc(sizeof(uint64_t) * (ap->k + 1) * words);
+        if (!r) {
+            out->failed = 1;
+            return;
+        }
+        size_t end = own_end + ap->pattern_len - 1;
+        if (words == 1) {
+            mismatch_search_one_word(ap, t, start, end, r, out);
+        } else {
+            mismatch_search_words(ap, t, start, end, r, out);
+        }
+        free(r);
+        return;
+    }
+
+    // Якорю p соответствует конец p + min_len - 1. Вхождение с не более чем k
+    // правками короче m + k + 1, поэтому счёт достаточно начать за m + k - 1
+    // байт до первого конца куска - так вхождения на границе не теряются
+    size_t first_end = start + approx_min_len(ap) - 1;
+    size_t end = own_end + approx_min_len(ap) - 1;
+    size_t back = approx_max_len(ap) - 1;
+    size_t scan_from = first_end > back ? first_end - back : 0;
+    uint64_t *state = malloc(sizeof(uint64_t) * 2 * words);
+    if (!state) {
+        out->failed = 1;
+        return;
+    }
+    edit_search(ap, t, scan_from, first_end, end, state, out);
+    free(state);
+}
@@ -0,0 +1,39 @@
+#ifndef APPROX_SEARCH_H
+#define APPROX_SEARCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "search_kernels.h"
+
+// Нечёткий поиск битовым параллелизмом: состояние автомата для всех
+// префиксов образца хранится в машинных словах и обновляется за несколько
+// операций на байт текста. Образцы длиннее 64 байт занимают несколько слов.
+typedef enum {
+    APPROX_MISMATCH,    // До k замен (расстояние Хэмминга), Shift-Or
+    APPROX_EDIT         // До k вставок/удалений/замен (Левенштейн), Майерс
+} ApproxMetric;
+
+typedef struct {
+    ApproxMetric metric;
+    int k;
+    size_t pattern_len;
+    int words;          // Слов на битовый вектор
+    uint64_t *peq;      // 256 * words: маска позиций образца, где стоит символ
+} ApproxPattern;
+
+// Возвращает NULL при ошибке или k >= длины образца (такой образец совпадает везде)
+ApproxPattern *approx_prepare(const char *pattern, size_t pattern_len, int k, ApproxMetric metric);
+void approx_release(ApproxPattern *ap);
+
+// Длины подстрок текста, которые могут совпасть: m для замен, [m - k, m + k] для правок
+size_t approx_min_len(const ApproxPattern *ap);
+size_t approx_max_len(const ApproxPattern *ap);
+
+// Вхождения с якорем в [start, own_end) по возрастанию.
+// Для замен якорь и выдаваемая позиция - начало вхождения (читается text[start, own_end + m - 1)).
+// Для правок начало неоднозначно, поэтому выдаётся позиция последнего байта вхождения;
+// якорь - конец минус (min_len - 1), а чтение начинается за m + k - 1 байт до первого конца.
+void approx_search(const ApproxPattern *ap, const char *text, size_t start, size_t own_end,
+                   MatchBuffer *out);
+
+#endif
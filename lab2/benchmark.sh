@@ -1,20 +1,13 @@
 #!/bin/bash
 
-echo "Performance benchmark for multithreaded string search"
-echo "===================================================="
+# Обёртка над стендом lab2_bench: сборка и прогон набора замеров.
+# Аргументы передаются стенду как есть, например:
+#   ./benchmark.sh -s 1M,1G -c dna,english -t 1,4,8 -o results.json
 
-gcc -o lab2_naive_search lab2_naive_search.c -lpthread
+echo "Performance benchmark for multithreaded string search" >&2
+echo "====================================================" >&2
 
-TEXT="abacabaabacababacabaabacababacabaabacababacabaabacaba"
-PATTERN="aba"
+gcc -O2 -o lab2_naive_search lab2_naive_search.c search_kernels.c search_engine.c aho_corasick.c thread_pool.c cpu_topology.c approx_search.c sa_index.c pattern_dfa.c perf_counters.c -lpthread || exit 1
+gcc -O2 -o lab2_bench lab2_bench.c || exit 1
 
-echo "Text: $TEXT"
-echo "Pattern: $PATTERN"
-echo ""
-
-for threads in 1 2 4 8
-do
-    echo "Threads: $threads"
-    ./lab2_naive_search $threads "$TEXT" "$PATTERN" | grep -E "(Time:|Threads used:)"
-    echo "----------------------------------------"
-done
\ No newline at end of file
+./lab2_bench -b ./lab2_naive_search "$@"
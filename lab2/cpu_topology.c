@@ -0,0 +1,170 @@
+#include "cpu_topology.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SYSFS_CPU "/sys/devices/system/cpu"
+
+static int read_int_file(const char *path, int fallback) {
+    FILE *file = fopen(path, "r");
+    if (!file) return fallback;
+    int value;
+    if (fscanf(file, "%d", &value) != 1) value = fallback;
+    fclose(file);
+    return value;
+}
+
+// Разбор списка вида "0-3,8,10-11". Возвращает число номеров или -1.
+static int parse_cpu_list(const char *list, int *out, int max) {
+    int count = 0;
+    const char *p = list;
+    while (*p) {
+        while (*p == ',' || isspace((unsigned char)*p)) p++;
+        if (!*p) break;
+        if (!isdigit((unsigned char)*p)) return -1;
+        char *next;
+        long first = strtol(p, &next, 10);
+        long last = first;
+        p = next;
+        if (*p == '-') {
+            last = strtol(p + 1, &next, 10);
+            if (next == p + 1 || last < first) return -1;
+            p = next;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            if (count < max) out[count] = (int)cpu;
+            count++;
+        }
+    }
+    return count;
+}
+
+// Узел процессора: каталог cpuN содержит ссылку nodeK
+static int read_cpu_node(int cpu) {
+    char path[128];
+    snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d", cpu);
+    DIR *dir = opendir(path);
+    if (!dir) return 0;
+    int node = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "node", 4) == 0 && isdigit((unsigned char)entry->d_name[4])) {
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+int cpu_topology_load(CpuTopology *topo) {
+    memset(topo, 0, sizeof(*topo));
+
+    char online[4096];
+    FILE *file = fopen(SYSFS_CPU "/online", "r");
+    if (!file) return -1;
+    if (!fgets(online, sizeof(online), file)) {
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    int count = parse_cpu_list(online, NULL, 0);
+    if (count <= 0) return -1;
+    int *ids = malloc(sizeof(int) * count);
+    topo->cpus = malloc(sizeof(CpuInfo) * count);
+    if (!ids || !topo->cpus) {
+        free(ids);
+        cpu_topology_free(topo);
+        return -1;
+    }
+    parse_cpu_list(online, ids, count);
+
+    for (int i = 0; i < count; i++) {
+        char path[160];
+        CpuInfo *info = &topo->cpus[i];
+        info->cpu = ids[i];
+        snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/topology/physical_package_id", ids[i]);
+        info->package = read_int_file(path, 0);
+        snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/topology/core_id", ids[i]);
+        info->core = read_int_file(path, ids[i]);
+        info->node = read_cpu_node(ids[i]);
+        if (info->package + 1 > topo->package_count) topo->package_count = info->package + 1;
+        if (info->node + 1 > topo->node_count) topo->node_count = info->node + 1;
+    }
+    topo->count = count;
+    free(ids);
+    return 0;
+}
+
+void cpu_topology_free(CpuTopology *topo) {
+    free(topo->cpus);
+    topo->cpus = NULL;
+    topo->count = 0;
+}
+
+int cpu_topology_node(const CpuTopology *topo, int cpu) {
+    for (int i = 0; i < topo->count; i++) {
+        if (topo->cpus[i].cpu == cpu) return topo->cpus[i].node;
+    }
+    return 0;
+}
+
+// Ключ сортировки: для compact - (сокет, ядро, SMT-поток),
+// для scatter - (SMT-поток, ядро, сокет), т.е. сначала по одному потоку на ядро
+typedef struct {
+    int key[3];
+    int cpu;
+} PlacementKey;
+
+static int compare_placement(const void *a, const void *b) {
+    const PlacementKey *x = a, *y = b;
+    for (int i = 0; i < 3; i++) {
+        if (x->key[i] != y->key[i]) return x->key[i] - y->key[i];
+    }
+    return x->cpu - y->cpu;
+}
+
+int cpu_affinity_plan(const CpuTopology *topo, const char *policy, int workers, int *cpus) {
+    if (isdigit((unsigned char)policy[0])) {
+        int listed = parse_cpu_list(policy, NULL, 0);
+        if (listed <= 0) return -1;
+        int *list = malloc(sizeof(int) * listed);
+        if (!list) return -1;
+        parse_cpu_list(policy, list, listed);
+        for (int i = 0; i < workers; i++) cpus[i] = list[i % listed];
+        free(list);
+        return 0;
+    }
+
+    int compact = strcmp(policy, "compact") == 0;
+    if (!compact && strcmp(policy, "scatter") != 0) return -1;
+    if (topo->count == 0) return -1;
+
+    PlacementKey *keys = malloc(sizeof(PlacementKey) * topo->count);
+    if (!keys) return -1;
+    for (int i = 0; i < topo->count; i++) {
+        const CpuInfo *info = &topo->cpus[i];
+        // Номер SMT-потока: сколько процессоров того же ядра идут раньше
+        int smt = 0;
+        for (int j = 0; j < i; j++) {
+            if (topo->cpus[j].package == info->package && topo->cpus[j].core == info->core) smt++;
+        }
+        keys[i].cpu = info->cpu;
+        if (compact) {
+            keys[i].key[0] = info->package;
+            keys[i].key[1] = info->core;
+            keys[i].key[2] = smt;
+        } else {
+            keys[i].key[0] = smt;
+            keys[i].key[1] = info->core;
+            keys[i].key[2] = info->package;
+        }
+    }
+    qsort(keys, topo->count, sizeof(PlacementKey), compare_placement);
+    for (int i = 0; i < workers; i++) cpus[i] = keys[i % topo->count].cpu;
+    free(keys);
+    return 0;
+}
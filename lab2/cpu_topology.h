@@ -0,0 +1,34 @@
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+// Топология процессоров из /sys/devices/system/cpu
+typedef struct {
+    int cpu;        // Номер логического процессора
+    int package;    // Сокет (physical_package_id)
+    int core;       // Физическое ядро внутри сокета (core_id)
+    int node;       // NUMA-узел (0, если узлы не описаны)
+} CpuInfo;
+
+typedef struct {
+    CpuInfo *cpus;
+    int count;
+    int package_count;
+    int node_count;
+} CpuTopology;
+
+// Чтение топологии онлайн-процессоров. Возвращает -1 при ошибке.
+int cpu_topology_load(CpuTopology *topo);
+void cpu_topology_free(CpuTopology *topo);
+
+// NUMA-узел процессора (0, если неизвестен)
+int cpu_topology_node(const CpuTopology *topo, int cpu);
+
+// Раскладка потоков по процессорам:
+//   "compact" - заполняем ядро за ядром и сокет за сокетом (общие кэши, один узел памяти);
+//   "scatter" - по очереди в разные сокеты и ядра (максимум пропускной способности памяти);
+//   "0,2,4-7" - явный список процессоров.
+// Если потоков больше, чем процессоров, раскладка повторяется по кругу.
+// Возвращает -1 при неизвестной политике или пустом списке.
+int cpu_affinity_plan(const CpuTopology *topo, const char *policy, int workers, int *cpus);
+
+#endif
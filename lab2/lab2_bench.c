@@ -0,0 +1,559 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Стенд производительности для lab2_naive_search.
+// Для каждого сочетания (корпус, размер, длина образца, плотность вхождений,
+// алгоритм, число потоков) запускается один процесс поиска с файлом запросов,
+// в котором образец повторён warmup + reps раз. Так время создания потоков
+// и первого чтения файла не попадает в замер: учитываются только повторы
+// после прогрева, по ним считаются медиана, p95 и пропускная способность.
+// Плотность: "present" - кусок корпуса (вхождений столько, сколько дал
+// корпус), "absent" - образец, которого в корпусе нет, и "<N>" - тот же
+// отсутствующий образец, вписанный в копию корпуса через каждые N байт.
+
+#define MAX_LIST 32
+#define GEN_BLOCK (1 << 20)
+#define DENSITY_ABSENT 0
+#define DENSITY_PRESENT SIZE_MAX
+
+typedef enum {
+    CORPUS_DNA,
+    CORPUS_ENGLISH,
+    CORPUS_RANDOM,
+    CORPUS_REPETITIVE,
+} CorpusKind;
+
+static const char *corpus_names[] = {"dna", "english", "random", "repetitive"};
+
+typedef struct {
+    const char *binary;
+    const char *dir;
+    const char *mode;
+    int corpora[MAX_LIST];
+    int corpus_count;
+    size_t sizes[MAX_LIST];
+    int size_count;
+    int lengths[MAX_LIST];
+    int length_count;
+    char *algorithms[MAX_LIST];
+    int algorithm_count;
+    int threads[MAX_LIST];
+    int thread_count;
+    size_t densities[MAX_LIST];     // DENSITY_ABSENT, DENSITY_PRESENT или шаг вписывания
+    int density_count;
+    int warmups;
+    int reps;
+    uint64_t seed;
+} BenchConfig;
+
+// xorshift64*: быстрый и воспроизводимый по seed генератор
+static uint64_t next_random(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static const char *english_words[] = {
+    "the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "was", "with",
+    "be", "by", "on", "not", "he", "this", "are", "or", "his", "from", "at", "which",
+    "but", "have", "an", "had", "they", "you", "were", "their", "one", "all", "we",
+    "can", "her", "has", "there", "been", "if", "more", "when", "will", "would", "who",
+    "so", "no", "search", "thread", "memory", "pattern", "process", "system", "kernel",
+    "performance", "parallel", "algorithm", "benchmark", "throughput", "latency",
+};
+
+// Заполнение блока текстом выбранного вида
+static void generate_block(CorpusKind kind, char *block, size_t len, uint64_t *rng, size_t *line) {
+    size_t word_count = sizeof(english_words) / sizeof(english_words[0]);
+    size_t i = 0;
+    switch (kind) {
+    case CORPUS_DNA:
+        while (i < len) {
+            uint64_t r = next_random(rng);
+            for (int k = 0; k < 32 && i < len; k++, r >>= 2) {
+                block[i++] = "ACGT"[r & 3];
+            }
+        }
+        break;
+    case CORPUS_ENGLISH:
+        // Частые короткие слова встречаются заметно чаще редких (приближение закона Ципфа)
+        while (i < len) {
+            uint64_t r = next_random(rng);
+            size_t index = (r % word_count) % ((r >> 32) % word_count + 1);
+            const char *word = english_words[index];
+            for (const char *p = word; *p && i < len; p++) block[i++] = *p;
+            *line += strlen(word) + 1;
+            if (i < len) {
+                if (*line > 72) {
+                    block[i++] = '\n';
+                    *line = 0;
+                } else {
+                    block[i++] = ((r >> 20) & 15) == 0 ? ',' : ' ';
+                }
+            }
+        }
+        break;
+    case CORPUS_RANDOM:
+        while (i < len) {
+            uint64_t r = next_random(rng);
+            for (int k = 0; k < 8 && i < len; k++, r >>= 8) {
+                block[i++] = (char)(r & 0xFF);
+            }
+        }
+        break;
+    case CORPUS_REPETITIVE:
+        // Длинные серии 'a' с редкими 'b' - худший случай для наивного поиска
+        while (i < len) {
+            uint64_t r = next_random(rng);
+            block[i++] = (r & 1023) == 0 ? 'b' : 'a';
+        }
+        break;
+    }
+}
+
+// Создаёт корпус, если файла нужного размера ещё нет. Возвращает -1 при ошибке.
+static int prepare_corpus(const BenchConfig *cfg, CorpusKind kind, size_t size, char *path, size_t path_size) {
+    snprintf(path, path_size, "%s/lab2_bench_%s_%zu_%llu.txt", cfg->dir, corpus_names[kind], size,
+             (unsigned long long)cfg->seed);
+    struct stat st;
+    if (stat(path, &st) == 0 && (size_t)st.st_size == size) {
+        return 0;
+    }
+
+    fprintf(stderr, "Generating %s (%zu bytes)\n", path, size);
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        perror("fopen");
+        return -1;
+    }
+    char *block = malloc(GEN_BLOCK);
+    if (block == NULL) {
+        fclose(file);
+        return -1;
+    }
+    uint64_t rng = cfg->seed * 0x9E3779B97F4A7C15ULL + (uint64_t)kind + 1;
+    size_t line = 0;
+    size_t written = 0;
+    int status = 0;
+    while (written < size) {
+        size_t len = size - written < GEN_BLOCK ? size - written : GEN_BLOCK;
+        generate_block(kind, block, len, &rng, &line);
+        if (fwrite(block, 1, len, file) != len) {
+            perror("fwrite");
+            status = -1;
+            break;
+        }
+        written += len;
+    }
+    free(block);
+    if (fclose(file) != 0) status = -1;
+    if (status != 0) unlink(path);
+    return status;
+}
+
+// Образец длины len из корпуса data. "present" - кусок текста, иначе в его
+// середину ставится байт, которого в корпусе нет вовсе; если корпус содержит
+// все байты (random), байт выбирается случайно, а образец проверяется
+// memmem по всему корпусу. Перевод строки в образце недопустим: запросы
+// передаются по одному на строку.
+static int make_pattern(const char *data, size_t size, int len, int absent, uint64_t *rng, char *out) {
+    int missing = -1;
+    if (absent) {
+        size_t freq[256] = {0};
+        for (size_t i = 0; i < size; i++) freq[(unsigned char)data[i]]++;
+        for (int c = 33; c < 127 && missing < 0; c++) {
+            if (freq[c] == 0) missing = c;
+        }
+        for (int c = 128; c < 256 && missing < 0; c++) {
+            if (freq[c] == 0) missing = c;
+        }
+    }
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        size_t offset = next_random(rng) % (size - len + 1);
+        memcpy(out, data + offset, len);
+        if (memchr(out, '\n', len) || memchr(out, '\r', len)) continue;
+        if (!absent) return 0;
+        if (missing >= 0) {
+            out[len / 2] = (char)missing;
+            return 0;
+        }
+        out[len / 2] = (char)next_random(rng);
+        if (out[len / 2] == '\n' || out[len / 2] == '\r') continue;
+        if (memmem(data, size, out, len) == NULL) return 0;
+    }
+    return -1;
+}
+
+// Копия корпуса с образцом, вписанным через каждые stride байт. Образца
+// в корпусе нет, поэтому вхождений ровно столько, сколько вписано
+// (stride >= len, вписанные копии не перекрываются).
+static int plant_corpus(const char *corpus_path, size_t size, const char *pattern, int len, size_t stride,
+                        const char *path) {
+    int fd = open(corpus_path, O_RDONLY);
+    if (fd < 0) {
+        perror("open");
+        return -1;
+    }
+    // Частное отображение: изменения копируются постранично и в файл корпуса не попадают
+    char *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    for (size_t offset = 0; offset + len <= size; offset += stride) {
+        memcpy(data + offset, pattern, len);
+    }
+    FILE *file = fopen(path, "wb");
+    int status = file && fwrite(data, 1, size, file) == size ? 0 : -1;
+    if (file && fclose(file) != 0) status = -1;
+    if (status != 0) {
+        perror(path);
+        unlink(path);
+    }
+    munmap(data, size);
+    return status;
+}
+
+static void format_density(size_t density, char *out, size_t out_size) {
+    if (density == DENSITY_ABSENT) snprintf(out, out_size, "absent");
+    else if (density == DENSITY_PRESENT) snprintf(out, out_size, "present");
+    else snprintf(out, out_size, "1/%zu", density);
+}
+
+typedef struct {
+    double *times;
+    int time_count;
+    size_t found;
+} RunResult;
+
+// Запуск поиска с файлом запросов и разбор строк "Time:" и "Found:" из вывода
+static int run_binary(const BenchConfig *cfg, const char *corpus_path, const char *queries_path,
+                      const char *algorithm, int threads, RunResult *result) {
+    int fds[2];
+    if (pipe(fds) == -1) {
+        perror("pipe");
+        return -1;
+    }
+    char thread_arg[16];
+    snprintf(thread_arg, sizeof(thread_arg), "%d", threads);
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execl(cfg->binary, cfg->binary, "-f", corpus_path, "-q", queries_path, "-m", cfg->mode,
+              "-a", algorithm, thread_arg, (char *)NULL);
+        perror("execl");
+        _exit(127);
+    }
+    close(fds[1]);
+
+    FILE *out = fdopen(fds[0], "r");
+    char *line = NULL;
+    size_t line_cap = 0;
+    int found_seen = 0;
+    result->time_count = 0;
+    result->found = 0;
+    while (out && getline(&line, &line_cap, out) != -1) {
+        double t;
+        size_t found;
+        if (sscanf(line, "Time: %lf", &t) == 1) {
+            if (result->time_count < cfg->warmups + cfg->reps) {
+                result->times[result->time_count++] = t;
+            }
+        } else if (!found_seen && sscanf(line, "Found: %zu", &found) == 1) {
+            result->found = found;
+            found_seen = 1;
+        }
+    }
+    free(line);
+    if (out) fclose(out);
+    else close(fds[0]);
+
+    int wstatus;
+    if (waitpid(pid, &wstatus, 0) == -1) {
+        perror("waitpid");
+        return -1;
+    }
+    if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0) {
+        fprintf(stderr, "%s exited with status %d\n", cfg->binary, WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : -1);
+        return -1;
+    }
+    return result->time_count == cfg->warmups + cfg->reps ? 0 : -1;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Перцентиль по рангу (nearest-rank) отсортированного массива
+static double percentile(const double *sorted, int count, double p) {
+    int rank = (int)(p * count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+static size_t parse_size(const char *s) {
+    char *end;
+    double value = strtod(s, &end);
+    if (end == s || value <= 0) return 0;
+    switch (*end) {
+    case 'G': case 'g': value *= 1024.0 * 1024 * 1024; end++; break;
+    case 'M': case 'm': value *= 1024.0 * 1024; end++; break;
+    case 'K': case 'k': value *= 1024.0; end++; break;
+    default: break;
+    }
+    return *end ? 0 : (size_t)value;
+}
+
+// Разбор списка через запятую; каждый элемент передаётся parse_item.
+// Возвращает число элементов или -1 при ошибке.
+static int parse_list(char *list, int (*parse_item)(const char *, void *, int), void *out) {
+    int count = 0;
+    for (char *item = strtok(list, ","); item; item = strtok(NULL, ",")) {
+        if (count == MAX_LIST || parse_item(item, out, count) != 0) return -1;
+        count++;
+    }
+    return count > 0 ? count : -1;
+}
+
+static int parse_corpus_item(const char *item, void *out, int index) {
+    for (int k = 0; k < 4; k++) {
+        if (strcmp(item, corpus_names[k]) == 0) {
+            ((int *)out)[index] = k;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int parse_size_item(const char *item, void *out, int index) {
+    size_t size = parse_size(item);
+    ((size_t *)out)[index] = size;
+    return size > 0 ? 0 : -1;
+}
+
+static int parse_int_item(const char *item, void *out, int index) {
+    int value = atoi(item);
+    ((int *)out)[index] = value;
+    return value > 0 ? 0 : -1;
+}
+
+static int parse_density_item(const char *item, void *out, int index) {
+    size_t density;
+    if (strcmp(item, "absent") == 0) density = DENSITY_ABSENT;
+    else if (strcmp(item, "present") == 0) density = DENSITY_PRESENT;
+    else if ((density = parse_size(item)) == 0) return -1;
+    ((size_t *)out)[index] = density;
+    return 0;
+}
+
+static int parse_string_item(const char *item, void *out, int index) {
+    ((char **)out)[index] = (char *)item;
+    return 0;
+}
+
+static void print_usage(const char *name) {
+    printf("Usage: %s [-b binary] [-d corpus_dir] [-c dna,english,random,repetitive]\n"
+           "       [-s 1M,64M,...] [-l 4,16,64] [-D present,absent,64K,1K] [-a auto,naive,...] [-t 1,2,4,8]\n"
+           "       [-w warmups] [-r reps] [-m count|all|exists] [-S seed] [-o result.json]\n", name);
+}
+
+int main(int argc, char *argv[]) {
+    BenchConfig cfg = {0};
+    cfg.binary = "./lab2_naive_search";
+    cfg.dir = "/tmp";
+    cfg.mode = "count";
+    cfg.warmups = 2;
+    cfg.reps = 5;
+    cfg.seed = 1;
+    const char *output_path = NULL;
+
+    char default_corpora[] = "dna,english,random,repetitive";
+    char default_sizes[] = "1M,64M";
+    char default_lengths[] = "4,16,64";
+    char default_algorithms[] = "auto,naive,horspool,twoway,kmp";
+    char default_threads[] = "1,2,4,8";
+    char default_densities[] = "present,absent,64K,1K";
+    char *corpora = default_corpora, *sizes = default_sizes, *lengths = default_lengths;
+    char *algorithms = default_algorithms, *threads = default_threads, *densities = default_densities;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "b:d:c:s:l:D:a:t:w:r:m:S:o:")) != -1) {
+        switch (opt) {
+        case 'b': cfg.binary = optarg; break;
+        case 'd': cfg.dir = optarg; break;
+        case 'c': corpora = optarg; break;
+        case 's': sizes = optarg; break;
+        case 'l': lengths = optarg; break;
+        case 'D': densities = optarg; break;
+        case 'a': algorithms = optarg; break;
+        case 't': threads = optarg; break;
+        case 'w': cfg.warmups = atoi(optarg); break;
+        case 'r': cfg.reps = atoi(optarg); break;
+        case 'm': cfg.mode = optarg; break;
+        case 'S': cfg.seed = strtoull(optarg, NULL, 10); break;
+        case 'o': output_path = optarg; break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    cfg.corpus_count = parse_list(corpora, parse_corpus_item, cfg.corpora);
+    cfg.size_count = parse_list(sizes, parse_size_item, cfg.sizes);
+    cfg.length_count = parse_list(lengths, parse_int_item, cfg.lengths);
+    cfg.algorithm_count = parse_list(algorithms, parse_string_item, cfg.algorithms);
+    cfg.thread_count = parse_list(threads, parse_int_item, cfg.threads);
+    cfg.density_count = parse_list(densities, parse_density_item, cfg.densities);
+    if (optind != argc || cfg.corpus_count < 0 || cfg.size_count < 0 || cfg.length_count < 0 || cfg.density_count < 0 ||
+        cfg.algorithm_count < 0 || cfg.thread_count < 0 || cfg.warmups < 0 || cfg.reps <= 0 || cfg.seed == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE *json = output_path ? fopen(output_path, "w") : stdout;
+    if (json == NULL) {
+        perror("fopen");
+        return 1;
+    }
+
+    int runs = cfg.warmups + cfg.reps;
+    double *times = malloc(sizeof(double) * runs);
+    char queries_path[4096];
+    snprintf(queries_path, sizeof(queries_path), "%s/lab2_bench_queries_%d.txt", cfg.dir, getpid());
+    char planted_path[4096];
+    snprintf(planted_path, sizeof(planted_path), "%s/lab2_bench_planted_%d.txt", cfg.dir, getpid());
+    uint64_t rng = cfg.seed;
+    int first_record = 1;
+    int status = 0;
+
+    fprintf(json, "{\n  \"binary\": \"%s\",\n  \"mode\": \"%s\",\n  \"warmups\": %d,\n  \"reps\": %d,\n"
+            "  \"seed\": %llu,\n  \"results\": [", cfg.binary, cfg.mode, cfg.warmups, cfg.reps,
+            (unsigned long long)cfg.seed);
+
+    for (int c = 0; c < cfg.corpus_count && status == 0; c++) {
+        for (int s = 0; s < cfg.size_count && status == 0; s++) {
+            CorpusKind kind = cfg.corpora[c];
+            size_t size = cfg.sizes[s];
+            char corpus_path[4096];
+            if (prepare_corpus(&cfg, kind, size, corpus_path, sizeof(corpus_path)) != 0) {
+                status = 1;
+                break;
+            }
+
+            int corpus_fd = open(corpus_path, O_RDONLY);
+            const char *corpus = corpus_fd < 0 ? MAP_FAILED : mmap(NULL, size, PROT_READ, MAP_PRIVATE, corpus_fd, 0);
+            if (corpus_fd >= 0) close(corpus_fd);
+            if (corpus == MAP_FAILED) {
+                perror(corpus_path);
+                status = 1;
+                break;
+            }
+
+            for (int l = 0; l < cfg.length_count && status == 0; l++) {
+                for (int d = 0; d < cfg.density_count && status == 0; d++) {
+                    int len = cfg.lengths[l];
+                    size_t density = cfg.densities[d];
+                    if ((size_t)len > size) continue;
+                    if (density != DENSITY_ABSENT && density != DENSITY_PRESENT && density < (size_t)len) {
+                        fprintf(stderr, "Skipping density 1/%zu for %d-byte patterns\n", density, len);
+                        continue;
+                    }
+                    char *pattern = malloc(len);
+                    if (pattern == NULL ||
+                        make_pattern(corpus, size, len, density != DENSITY_PRESENT, &rng, pattern) != 0) {
+                        fprintf(stderr, "Cannot pick a %d-byte pattern from %s\n", len, corpus_path);
+                        free(pattern);
+                        continue;
+                    }
+                    const char *text_path = corpus_path;
+                    if (density != DENSITY_ABSENT && density != DENSITY_PRESENT) {
+                        if (plant_corpus(corpus_path, size, pattern, len, density, planted_path) != 0) {
+                            free(pattern);
+                            status = 1;
+                            break;
+                        }
+                        text_path = planted_path;
+                    }
+                    char density_name[32];
+                    format_density(density, density_name, sizeof(density_name));
+
+                    FILE *queries = fopen(queries_path, "wb");
+                    if (queries == NULL) {
+                        perror("fopen");
+                        free(pattern);
+                        status = 1;
+                        break;
+                    }
+                    for (int i = 0; i < runs; i++) {
+                        fwrite(pattern, 1, len, queries);
+                        fputc('\n', queries);
+                    }
+                    fclose(queries);
+                    free(pattern);
+
+                    for (int a = 0; a < cfg.algorithm_count; a++) {
+                        for (int t = 0; t < cfg.thread_count; t++) {
+                            RunResult result = {times, 0, 0};
+                            if (run_binary(&cfg, text_path, queries_path, cfg.algorithms[a], cfg.threads[t],
+                                           &result) != 0) {
+                                fprintf(stderr, "Run failed: %s %zu %s threads=%d\n", corpus_names[kind], size,
+                                        cfg.algorithms[a], cfg.threads[t]);
+                                continue;
+                            }
+
+                            double *measured = times + cfg.warmups;
+                            qsort(measured, cfg.reps, sizeof(double), compare_doubles);
+                            double median = percentile(measured, cfg.reps, 0.5);
+                            double p95 = percentile(measured, cfg.reps, 0.95);
+                            double gbps = median > 0 ? size / median / 1e9 : 0;
+
+                            fprintf(stderr, "%-10s %10zu len=%-3d %-7s %-8s threads=%-2d median=%.6fs p95=%.6fs"
+                                    " %.2f GB/s found=%zu\n", corpus_names[kind], size, len,
+                                    density_name, cfg.algorithms[a], cfg.threads[t],
+                                    median, p95, gbps, result.found);
+                            fprintf(json, "%s\n    {\"corpus\": \"%s\", \"size\": %zu, \"pattern_len\": %d,"
+                                    " \"density\": \"%s\", \"matches\": %zu, \"algorithm\": \"%s\", \"threads\": %d,"
+                                    " \"median_sec\": %.9f, \"p95_sec\": %.9f, \"min_sec\": %.9f, \"gb_per_sec\": %.4f}",
+                                    first_record ? "" : ",", corpus_names[kind], size, len,
+                                    density_name, result.found, cfg.algorithms[a],
+                                    cfg.threads[t], median, p95, measured[0], gbps);
+                            first_record = 0;
+                        }
+                    }
+                    if (text_path == planted_path) unlink(planted_path);
+                }
+            }
+            munmap((void *)corpus, size);
+        }
+    }
+
+    fprintf(json, "\n  ]\n}\n");
+    if (output_path) fclose(json);
+    unlink(queries_path);
+    free(times);
+    return status;
+}
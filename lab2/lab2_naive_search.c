@@ -4,141 +4,1244 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "search_engine.h"
+#include "aho_corasick.h"
+#include "approx_search.h"
+#include "sa_index.h"
+#include "pattern_dfa.h"
+#include "thread_pool.h"
+#include "cpu_topology.h"
+
+// Размер одной задачи по умолчанию: кусок текста порядка L2-кэша.
+// Мелкие задачи позволяют свободным потокам забирать работу у занятых.
+#define SEARCH_TASK_SIZE (256 * 1024)
+
+// Размер блока потокового режима: читатель заполняет следующий блок,
+// пока пул сканирует текущий
+#define STREAM_BLOCK_SIZE (16 * 1024 * 1024)
 
 int MAX_THREADS = 4;
 
+// Байты, просканированные одним потоком пула (режим профилирования).
+// Каждый поток пишет только в свою строку кэша.
+typedef struct {
+    size_t bytes;
+} __attribute__((aligned(64))) WorkerBytes;
+
+// Одна задача - кусок текста. Вхождения, начинающиеся в [start, own_end),
+// принадлежат задаче; end захватывает перекрытие max_len - 1 со следующим куском.
 typedef struct {
-    int id;
-    char *text;
-    char *pattern;
-    int start;
-    int end;
-    int pattern_len;
-    int *results;
-    int *result_count;
-    pthread_mutex_t *mutex;
-} ThreadData;
+    size_t start;
+    size_t end;
+    size_t own_end;
+    MatchBuffer matches;    // Вхождения одного образца
+    AcMatchList pairs;      // Вхождения нескольких образцов
+    size_t match_count;
+    size_t out_offset;      // Место задачи в итоговом массиве (префиксная сумма)
+    int failed;             // Задаче не хватило памяти
+    int done;               // Задача завершена (для режима первых K)
+} SearchTask;
+
+// Один запрос к тексту: один образец (engine) или набор образцов (ac)
+typedef struct {
+    const char *text;
+    size_t text_len;
+    size_t min_len;
+    size_t max_len;
+    const SearchEngine *engine;
+    const void *prepared;   // Предобработка образца, общая для всех потоков
+    const AhoCorasick *ac;  // Автомат для режима нескольких образцов
+    const ApproxPattern *approx;    // Нечёткий поиск с k заменами или правками
+    const PatternDfa *dfa;  // Образец с подстановками и классами символов
+    MatchMode mode;
+    size_t limit;           // K для режима первых K
+    // Задачи с номером >= cancel_from не нужны: ответ уже известен
+    _Atomic size_t cancel_from;
+    // Сколько задач подряд с начала текста уже завершено и сколько в них вхождений
+    pthread_mutex_t progress_lock;
+    size_t prefix_done;
+    size_t prefix_count;
+    SearchTask *tasks;
+    size_t task_count;
+    size_t task_size;
+    size_t elem_size;
+    void *merged;           // Итог: позиции (size_t) или пары AcMatch по возрастанию
+    size_t total;
+    int first_touch;        // Перед поиском каждый поток читает свои страницы текста
+    // Если не 0: начала >= positions_limit не ищутся (хвост блока потока,
+    // который войдёт в следующий блок как перенос)
+    size_t positions_limit;
+    ThreadPool *pool;
+    WorkerBytes *scanned;   // По элементу на поток или NULL без профилирования
+    size_t steals;          // Кражи за проходы поиска (без прогрева и копирования)
+} SearchJob;
+
+int compare_ac_matches(const void *a, const void *b) {
+    const AcMatch *x = a, *y = b;
+    if (x->offset != y->offset) return (x->offset > y->offset) - (x->offset < y->offset);
+    return (x->pattern_id > y->pattern_id) - (x->pattern_id < y->pattern_id);
+}
+
+// Опускает границу отмены до bound, если она сейчас выше
+void lower_cancel_bound(SearchJob *job, size_t bound) {
+    size_t current = atomic_load(&job->cancel_from);
+    while (bound < current && !atomic_compare_exchange_weak(&job->cancel_from, &current, bound)) {
+    }
+}
+
+// Проверка, известен ли уже ответ, после завершения задачи
+void finish_task(SearchJob *job, size_t index) {
+    SearchTask *task = &job->tasks[index];
+    
+    if (job->mode == MATCH_EXISTS) {
+        if (task->match_count > 0) lower_cancel_bound(job, 0);
+        return;
+    }
+    
+    // Первые K: если задача сама набрала K, все следующие задачи не нужны
+    if (task->match_count >= job->limit) {
+        lower_cancel_bound(job, index + 1);
+    }
+    
+    // Задачи завершаются не по порядку; как только непрерывный префикс
+    // завершённых задач набрал K вхождений, остальные можно отменить
+    pthread_mutex_lock(&job->progress_lock);
+    task->done = 1;
+    while (job->prefix_done < job->task_count && job->tasks[job->prefix_done].done) {
+        job->prefix_count += job->tasks[job->prefix_done].match_count;
+        job->prefix_done++;
+    }
+    if (job->prefix_count >= job->limit) {
+        lower_cancel_bound(job, job->prefix_done);
+    }
+    pthread_mutex_unlock(&job->progress_lock);
+}
 
-pthread_t* threads;
-pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+void search_task_function(void *ctx, size_t index, int worker) {
+    SearchJob *job = ctx;
+    SearchTask *task = &job->tasks[index];
+    
+    if (atomic_load_explicit(&job->cancel_from, memory_order_relaxed) <= index) {
+        return;
+    }
+    
+    MatchControl control = { job->mode, job->limit, index, NULL };
+    if (job->mode == MATCH_EXISTS || job->mode == MATCH_FIRST_K) {
+        control.cancel_from = &job->cancel_from;
+    }
+    task->matches.control = control;
+    task->pairs.control = control;
+    if (job->scanned) {
+        job->scanned[worker].bytes += task->end - task->start;
+    }
+    
+    if (job->ac) {
+        // Один проход автомата по куску находит сразу все образцы
+        task->failed = ac_search(job->ac, job->text, task->start, task->end, task->own_end,
+                                 &task->pairs) != 0;
+        // Автомат выдаёт вхождения по позиции конца - упорядочиваем по началу
+        if (job->mode != MATCH_COUNT) {
+            qsort(task->pairs.items, task->pairs.count, sizeof(AcMatch), compare_ac_matches);
+        }
+        task->match_count = task->pairs.count;
+    } else if (job->approx) {
+        approx_search(job->approx, job->text, task->start, task->own_end, &task->matches);
+        task->failed = task->matches.failed;
+        task->match_count = task->matches.count;
+    } else if (job->dfa) {
+        // Перекрытие кусков - max_len - 1: вхождение с начала в куске целиком до end
+        pattern_dfa_search(job->dfa, job->text, task->start, task->own_end, task->end, &task->matches);
+        task->failed = task->matches.failed;
+        task->match_count = task->matches.count;
+    } else {
+        // Локальный буфер растёт по мере нахождения вхождений
+        job->engine->search(job->prepared, job->text, task->start, task->end, &task->matches);
+        task->failed = task->matches.failed;
+        task->match_count = task->matches.count;
+    }
+    
+    if (job->mode == MATCH_EXISTS || job->mode == MATCH_FIRST_K) {
+        finish_task(job, index);
+    }
+}
+
+// NUMA first-touch: страницы page cache выделяются на узле процессора,
+// который первым их прочитал. Поток пула читает по байту со страницы
+// в тех задачах, которые он получит при начальной раздаче, и потом
+// сканирует уже локальную память.
+void touch_task_function(void *ctx, size_t index, int worker) {
+    SearchJob *job = ctx;
+    size_t lo, hi;
+    thread_pool_initial_range(job->pool, job->task_count, worker, &lo, &hi);
+    (void)index;
+    if (lo >= hi) return;
+    
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    volatile const char *text = job->text;
+    char sum = 0;
+    for (size_t pos = job->tasks[lo].start; pos < job->tasks[hi - 1].own_end; pos += page_size) {
+        sum += text[pos];
+    }
+    (void)sum;
+}
+
+// Сборка результатов без блокировок: каждая задача копирует свои вхождения
+// в итоговый массив по смещению из префиксной суммы. Задачи идут по порядку
+// текста, поэтому итог отсортирован.
+void copy_task_function(void *ctx, size_t index, int worker) {
+    (void)worker;
+    SearchJob *job = ctx;
+    SearchTask *task = &job->tasks[index];
+    const void *items = job->ac ? (const void *)task->pairs.items : (const void *)task->matches.positions;
+    
+    // В режимах с ограничением копируется только то, что попадает в первые total
+    if (task->out_offset < job->total) {
+        size_t count = task->match_count;
+        if (count > job->total - task->out_offset) count = job->total - task->out_offset;
+        memcpy((char *)job->merged + task->out_offset * job->elem_size, items,
+               count * job->elem_size);
+    }
+    free(task->pairs.items);
+    free(task->matches.positions);
+}
+
+// Счётчики краж в пуле накопительные: их сумма до и после прохода даёт кражи прохода
+static size_t pool_total_steals(ThreadPool *pool) {
+    size_t steals = 0;
+    for (int i = 0; i < thread_pool_size(pool); i++) {
+        steals += thread_pool_worker_stats(pool, i).steals;
+    }
+    return steals;
+}
+
+// Нарезка текста на задачи и выполнение запроса пулом. Возвращает -1 при нехватке памяти.
+int run_search(ThreadPool *pool, SearchJob *job, size_t task_size) {
+    size_t positions = job->text_len - job->min_len + 1;
+    if (job->positions_limit && job->positions_limit < positions) positions = job->positions_limit;
+    size_t workers = (size_t)thread_pool_size(pool);
+    
+    // Если текст мал для задач полного размера, режем поровну между потоками.
+    // Размер задачи кратен странице, чтобы задачи не делили страницы файла.
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    if (positions / workers < task_size) {
+        task_size = (positions + workers - 1) / workers;
+        if (task_size >= page_size) {
+            task_size = (task_size + page_size - 1) / page_size * page_size;
+        }
+    }
+    job->task_size = task_size;
+    job->task_count = (positions + task_size - 1) / task_size;
+    job->elem_size = job->ac ? sizeof(AcMatch) : sizeof(size_t);
+    job->tasks = calloc(job->task_count, sizeof(SearchTask));
+    if (job->tasks == NULL) {
+        return -1;
+    }
+    
+    atomic_store(&job->cancel_from, job->task_count);
+    pthread_mutex_init(&job->progress_lock, NULL);
+    job->prefix_done = 0;
+    job->prefix_count = 0;
+    
+    for (size_t i = 0; i < job->task_count; i++) {
+        SearchTask *task = &job->tasks[i];
+        task->start = i * task_size;
+        task->own_end = task->start + task_size < positions ? task->start + task_size : positions;
+        task->end = task->own_end + job->max_len - 1;
+        if (task->end > job->text_len) task->end = job->text_len;
+    }
+    
+    job->pool = pool;
+    if (job->first_touch) {
+        thread_pool_run_each(pool, touch_task_function, job);
+    }
+    
+    size_t steals_before = pool_total_steals(pool);
+    thread_pool_run(pool, job->task_count, search_task_function, job);
+    job->steals += pool_total_steals(pool) - steals_before;
+    pthread_mutex_destroy(&job->progress_lock);
+    
+    // Префиксная сумма количеств по задачам
+    int failed = 0;
+    job->total = 0;
+    for (size_t i = 0; i < job->task_count; i++) {
+        job->tasks[i].out_offset = job->total;
+        job->total += job->tasks[i].match_count;
+        if (job->tasks[i].failed) failed = 1;
+    }
+    
+    // Для подсчёта позиции не хранились - копировать нечего
+    if (job->mode == MATCH_COUNT && !failed) {
+        free(job->tasks);
+        job->tasks = NULL;
+        return 0;
+    }
+    
+    // Задачи до границы отмены завершены целиком и вместе содержат не меньше limit
+    // вхождений, а всё, что найдено после, лежит дальше по тексту
+    if (job->mode == MATCH_EXISTS && job->total > 1) job->total = 1;
+    if (job->mode == MATCH_FIRST_K && job->total > job->limit) job->total = job->limit;
+    
+    job->merged = failed ? NULL : malloc(job->elem_size * (job->total ? job->total : 1));
+    if (job->merged == NULL) {
+        for (size_t i = 0; i < job->task_count; i++) {
+            free(job->tasks[i].pairs.items);
+            free(job->tasks[i].matches.positions);
+        }
+        free(job->tasks);
+        job->tasks = NULL;
+        return -1;
+    }
+    
+    thread_pool_run(pool, job->task_count, copy_task_function, job);
+    
+    free(job->tasks);
+    job->tasks = NULL;
+    return 0;
+}
 
-void naive_search(const char *text, const char *pattern, int start, int end, 
-                  int pattern_len, int *positions, int *count) {
-    for (int i = start; i <= end - pattern_len; i++) {
-        int j;
-        for (j = 0; j < pattern_len; j++) {
-            if (text[i + j] != pattern[j]) break;
+// Чтение файла образцов: по одному образцу на строку, пустые строки пропускаются.
+// Номер образца - его порядковый номер среди непустых строк.
+int load_patterns(const char *path, char **buffer, char ***patterns, int **lengths) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror("fopen");
+        return -1;
+    }
+    
+    size_t size = 0, capacity = 4096;
+    char *data = malloc(capacity);
+    size_t n;
+    while (data && (n = fread(data + size, 1, capacity - size, file)) > 0) {
+        size += n;
+        if (size == capacity) {
+            capacity *= 2;
+            char *grown = realloc(data, capacity);
+            if (!grown) free(data);
+            data = grown;
         }
-        if (j == pattern_len) {
-            positions[*count] = i;
-            (*count)++;
+    }
+    fclose(file);
+    if (data == NULL) {
+        return -1;
+    }
+    
+    int count = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (data[i] == '\n') count++;
+    }
+    count++;
+    
+    char **ptrs = malloc(sizeof(char *) * count);
+    int *lens = malloc(sizeof(int) * count);
+    if (!ptrs || !lens) {
+        free(data);
+        free(ptrs);
+        free(lens);
+        return -1;
+    }
+    
+    int found = 0;
+    size_t line_start = 0;
+    for (size_t i = 0; i <= size; i++) {
+        if (i == size || data[i] == '\n') {
+            size_t len = i - line_start;
+            if (len > 0 && data[line_start + len - 1] == '\r') len--;
+            if (len > 0) {
+                ptrs[found] = data + line_start;
+                lens[found] = (int)len;
+                found++;
+            }
+            line_start = i + 1;
         }
     }
+    
+    *buffer = data;
+    *patterns = ptrs;
+    *lengths = lens;
+    return found;
 }
 
-void* thread_function(void *arg) {
-    ThreadData *data = (ThreadData *)arg;
+// Отображение файла с текстом в память. Читаем через page cache,
+// поэтому файлы в десятки гигабайт не требуют собственной памяти процесса.
+const char *map_text_file(const char *path, size_t *length) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        perror("open");
+        return NULL;
+    }
     
-    // Локальные переменные (у каждого потока свои)
-    int local_count = 0;
-    int *local_positions = malloc(sizeof(int) * (data->end - data->start));
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror("fstat");
+        close(fd);
+        return NULL;
+    }
     
-    // Ищем в своей области
-    naive_search(data->text, data->pattern, data->start, data->end, 
-                data->pattern_len, local_positions, &local_count);
+    *length = (size_t)st.st_size;
+    if (*length == 0) {
+        close(fd);
+        return "";
+    }
     
-    pthread_mutex_lock(data->mutex);
-    for (int i = 0; i < local_count; i++) {
-        data->results[*data->result_count] = local_positions[i];
-        (*data->result_count)++;
+    void *addr = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
     }
-    pthread_mutex_unlock(data->mutex);
     
-    free(local_positions);
-    return NULL;
+    // Подсказки ядру: последовательное чтение (агрессивный readahead)
+    // и, где поддерживается, большие страницы. Ошибки не критичны.
+    madvise(addr, *length, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(addr, *length, MADV_HUGEPAGE);
+#endif
+    return addr;
 }
 
-int main(int argc, char *argv[]) {
-    if (argc != 4) {
-        printf("Usage: %s <max_threads> <text> <pattern>\n", argv[0]);
-        return 1;
+// Движок поиска; для наивного - ещё и ядро, выбранное по возможностям CPU
+static void print_engine(const SearchEngine *engine) {
+    printf("Algorithm: %s\n", engine->name);
+    if (engine == &naive_engine) {
+        const char *kernel_name;
+        select_search_kernel(&kernel_name);
+        printf("Kernel: %s\n", kernel_name);
+    }
+}
+
+void print_results(const SearchJob *job, double time_sec, ThreadPool *pool) {
+    if (job->mode == MATCH_COUNT) {
+        printf("Found: %zu\n", job->total);
+    } else if (job->mode == MATCH_EXISTS) {
+        if (job->total == 0) {
+            printf("Exists: no\n");
+        } else if (job->ac) {
+            const AcMatch *pair = job->merged;
+            printf("Exists: yes (%d:%zu)\n", pair->pattern_id, pair->offset);
+        } else {
+            printf("Exists: yes (%zu)\n", *(const size_t *)job->merged);
+        }
+    } else if (job->ac) {
+        // Пары "номер_образца:смещение"
+        const AcMatch *pairs = job->merged;
+        printf("Found: %zu\n", job->total);
+        for (size_t i = 0; i < job->total; i++) {
+            printf("%d:%zu ", pairs[i].pattern_id, pairs[i].offset);
+        }
+    } else {
+        const size_t *results = job->merged;
+        printf("Found: %zu\n", job->total);
+        for (size_t i = 0; i < job->total; i++) {
+            printf("%zu ", results[i]);
+        }
+    }
+    if (job->mode == MATCH_ALL || job->mode == MATCH_FIRST_K) {
+        printf("\n");
     }
     
-    MAX_THREADS = atoi(argv[1]);
-    char *text = argv[2];
-    char *pattern = argv[3];
+    printf("Time: %lf seconds\n", time_sec);
+    printf("Threads used: %d (max: %d)\n", thread_pool_size(pool), MAX_THREADS);
+    printf("Tasks: %zu x %zu bytes, steals: %zu\n", job->task_count, job->task_size, job->steals);
+    if (job->ac) {
+        printf("Algorithm: aho-corasick (%d patterns, %d states)\n", job->ac->pattern_count, job->ac->state_count);
+    } else if (job->dfa) {
+        const PatternDfa *dfa = job->dfa;
+        printf("Algorithm: dfa (%d states, %d byte classes, ", dfa->live_states, dfa->class_count);
+        if (dfa->prefix_len >= 2 || (dfa->prefix_len == 1 && !dfa->scan_next)) {
+            printf("prefilter: prefix \"%.*s\")\n", (int)dfa->prefix_len, dfa->prefix);
+        } else if (dfa->scan_next) {
+            printf("unanchored scan: %d states)\n", dfa->scan_states);
+        } else {
+            printf("prefilter: %d first bytes)\n", dfa->first_byte_count);
+        }
+    } else if (job->approx) {
+        if (job->approx->metric == APPROX_MISMATCH) {
+            printf("Algorithm: shift-or, up to %d mismatches (start offsets)\n", job->approx->k);
+        } else {
+            printf("Algorithm: myers, up to %d edits (end offsets)\n", job->approx->k);
+        }
+    } else {
+        print_engine(job->engine);
+    }
+}
+
+// Отчёт профилирования за один запрос: разность статистики пула до и после
+void print_profile(ThreadPool *pool, const PoolWorkerStats *before, const WorkerBytes *scanned,
+                   double time_sec) {
+    int workers = thread_pool_size(pool);
+    uint64_t total[PERF_COUNTER_COUNT] = {0};
+    uint64_t total_busy = 0, total_idle = 0;
+    size_t total_bytes = 0;
+    int counters_open = PERF_COUNTER_COUNT;
     
-    int text_len = strlen(text);
-    int pattern_len = strlen(pattern);
+    printf("Profile:\n");
+    for (int i = 0; i < workers; i++) {
+        PoolWorkerStats st = thread_pool_worker_stats(pool, i);
+        uint64_t busy = st.busy_ns - before[i].busy_ns;
+        uint64_t idle = st.idle_ns - before[i].idle_ns;
+        uint64_t value[PERF_COUNTER_COUNT];
+        for (int c = 0; c < PERF_COUNTER_COUNT; c++) {
+            value[c] = st.counters[c] - before[i].counters[c];
+            total[c] += value[c];
+        }
+        total_busy += busy;
+        total_idle += idle;
+        total_bytes += scanned[i].bytes;
+        if (st.counters_open < counters_open) counters_open = st.counters_open;
+        
+        // Скорость потока - по времени, проведённому в задачах
+        printf("  Worker %d: busy %.6lf s, idle %.6lf s, scanned %zu bytes (%.2lf GB/s)", i,
+               busy / 1e9, idle / 1e9, scanned[i].bytes, busy ? scanned[i].bytes / (double)busy : 0.0);
+        if (st.counters_open > 0) {
+            for (int c = 0; c < PERF_COUNTER_COUNT; c++) {
+                printf(", %s %llu", perf_counter_name(c), (unsigned long long)value[c]);
+            }
+            if (value[PERF_CYCLES]) printf(", IPC %.2lf", (double)value[PERF_INSTRUCTIONS] / value[PERF_CYCLES]);
+        }
+        printf("\n");
+    }
     
-    if (pattern_len > text_len) {
-        printf("Pattern longer than text\n");
+    // Общая скорость - по времени запроса, а не по сумме занятости потоков
+    printf("  Total: busy %.6lf s, idle %.6lf s, scanned %zu bytes (%.2lf GB/s)", total_busy / 1e9,
+           total_idle / 1e9, total_bytes, time_sec > 0 ? total_bytes / time_sec / 1e9 : 0.0);
+    if (counters_open > 0) {
+        for (int c = 0; c < PERF_COUNTER_COUNT; c++) {
+            printf(", %s %llu", perf_counter_name(c), (unsigned long long)total[c]);
+        }
+        if (total[PERF_CYCLES]) printf(", IPC %.2lf", (double)total[PERF_INSTRUCTIONS] / total[PERF_CYCLES]);
+        if (counters_open < PERF_COUNTER_COUNT) printf(" (some counters unavailable)");
+        printf("\n");
+    } else {
+        printf(", hardware counters unavailable\n");
+    }
+}
+
+// ---------- Потоковый режим ----------
+// Текст читается из stdin блоками в два буфера: читатель заполняет один,
+// пока пул ищет в другом. Каждый буфер начинается с переноса - последних
+// max_len - 1 байт предыдущего блока, - так вхождения на стыке не теряются.
+// Начала в переносе откладываются до следующего блока, поэтому ни одно
+// вхождение не выдаётся дважды, а память не зависит от длины потока.
+
+typedef struct {
+    char *data;             // carry_capacity + block_size байт
+    size_t len;             // Перенос + новые данные
+    unsigned long long offset;  // Глобальное смещение data[0]
+    int eof;                // Последний блок потока
+    int full;               // Буфер заполнен и ждёт поиска
+} StreamBuffer;
+
+typedef struct {
+    int fd;
+    size_t block_size;
+    size_t carry_capacity;  // max_len - 1
+    StreamBuffer buffers[2];
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int stop;               // Поиску больше не нужны данные
+    int error;
+    char *tail;             // Перенос для следующего буфера
+    unsigned long long bytes_read;
+} StreamReader;
+
+void *stream_reader_main(void *arg) {
+    StreamReader *reader = arg;
+    // Отмена разрешена только внутри read(): там читатель может ждать данных бесконечно
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    
+    char *tail = reader->tail;
+    size_t tail_len = 0;
+    unsigned long long offset = 0;
+    for (int i = 0;; i++) {
+        StreamBuffer *buf = &reader->buffers[i & 1];
+        pthread_mutex_lock(&reader->lock);
+        while (buf->full && !reader->stop) {
+            pthread_cond_wait(&reader->changed, &reader->lock);
+        }
+        int stop = reader->stop;
+        pthread_mutex_unlock(&reader->lock);
+        if (stop) break;
+        
+        memcpy(buf->data, tail, tail_len);
+        size_t got = 0;
+        int eof = 0;
+        while (got < reader->block_size) {
+            pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+            ssize_t n = read(reader->fd, buf->data + tail_len + got, reader->block_size - got);
+            pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+            if (n < 0) {
+                perror("read");
+                reader->error = 1;
+                eof = 1;
+                break;
+            }
+            if (n == 0) {
+                eof = 1;
+                break;
+            }
+            got += (size_t)n;
+        }
+        buf->len = tail_len + got;
+        buf->offset = offset - tail_len;
+        buf->eof = eof;
+        offset += got;
+        
+        // Новый перенос - хвост только что прочитанного буфера
+        tail_len = buf->len < reader->carry_capacity ? buf->len : reader->carry_capacity;
+        memcpy(tail, buf->data + buf->len - tail_len, tail_len);
+        
+        pthread_mutex_lock(&reader->lock);
+        reader->bytes_read = offset;
+        buf->full = 1;
+        pthread_cond_broadcast(&reader->changed);
+        pthread_mutex_unlock(&reader->lock);
+        if (eof) break;
+    }
+    return NULL;
+}
+
+// Вывод вхождений блока с глобальными смещениями.
+// Возвращает 1, если ответ получен и поток можно не дочитывать.
+int emit_stream_matches(SearchJob *job, unsigned long long base, size_t *emitted) {
+    if (job->mode == MATCH_COUNT) {
+        *emitted += job->total;
+        return 0;
+    }
+    if (job->mode == MATCH_EXISTS) {
+        if (job->total == 0) return 0;
+        if (job->ac) {
+            const AcMatch *pair = job->merged;
+            printf("Exists: yes (%d:%llu)\n", pair->pattern_id, base + pair->offset);
+        } else {
+            printf("Exists: yes (%llu)\n", base + *(const size_t *)job->merged);
+        }
+        *emitted = 1;
+        return 1;
+    }
+    for (size_t i = 0; i < job->total; i++) {
+        if (job->ac) {
+            const AcMatch *pair = (const AcMatch *)job->merged + i;
+            printf("%d:%llu ", pair->pattern_id, base + pair->offset);
+        } else {
+            printf("%llu ", base + ((const size_t *)job->merged)[i]);
+        }
+    }
+    *emitted += job->total;
+    fflush(stdout);
+    // job->limit - сколько вхождений не хватало до K перед этим блоком
+    return job->mode == MATCH_FIRST_K && job->total >= job->limit;
+}
+
+// Поиск в потоке stdin. Запрос (job) уже подготовлен, text не используется.
+int run_stream(ThreadPool *pool, SearchJob *job, size_t task_size, size_t block_size) {
+    StreamReader reader = {0};
+    reader.fd = STDIN_FILENO;
+    reader.block_size = block_size;
+    reader.carry_capacity = job->max_len - 1;
+    // Блок не короче вхождения: иначе у блока не было бы своих начал
+    if (block_size < job->max_len) {
+        block_size = job->max_len;
+        reader.block_size = block_size;
+    }
+    pthread_mutex_init(&reader.lock, NULL);
+    pthread_cond_init(&reader.changed, NULL);
+    reader.tail = malloc(reader.carry_capacity + 1);
+    reader.buffers[0].data = malloc(reader.carry_capacity + block_size);
+    reader.buffers[1].data = malloc(reader.carry_capacity + block_size);
+    if (!reader.tail || !reader.buffers[0].data || !reader.buffers[1].data) {
+        printf("Out of memory for stream buffers\n");
+        free(reader.tail);
+        free(reader.buffers[0].data);
+        free(reader.buffers[1].data);
         return 1;
     }
     
-    if (MAX_THREADS <= 0) {
-        printf("Thread count must be positive\n");
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, stream_reader_main, &reader) != 0) {
+        printf("Cannot start reader thread\n");
+        free(reader.tail);
+        free(reader.buffers[0].data);
+        free(reader.buffers[1].data);
         return 1;
     }
     
-    int actual_threads = (text_len - pattern_len + 1 < MAX_THREADS) ? 
-                        text_len - pattern_len + 1 : MAX_THREADS;
+    size_t limit = job->limit;
+    size_t emitted = 0;
+    size_t blocks = 0;
+    int status = 0;
+    for (int i = 0;; i++) {
+        StreamBuffer *buf = &reader.buffers[i & 1];
+        pthread_mutex_lock(&reader.lock);
+        while (!buf->full) {
+            pthread_cond_wait(&reader.changed, &reader.lock);
+        }
+        pthread_mutex_unlock(&reader.lock);
+        blocks++;
+        
+        // В незавершающем блоке начала в последних max_len - 1 байтах уйдут в следующий
+        int done = 0;
+        size_t own = buf->eof ? 0 : buf->len - reader.carry_capacity;
+        if (buf->len >= job->min_len && (buf->eof || own > 0)) {
+            job->text = buf->data;
+            job->text_len = buf->len;
+            job->positions_limit = own;
+            if (job->mode == MATCH_FIRST_K) job->limit = limit - emitted;
+            job->merged = NULL;
+            if (run_search(pool, job, task_size) != 0) {
+                printf("\nOut of memory while collecting results\n");
+                status = 1;
+                done = 1;
+            } else {
+                done = emit_stream_matches(job, buf->offset, &emitted);
+            }
+            free(job->merged);
+            job->merged = NULL;
+        }
+        done = done || buf->eof || reader.error;
+        
+        pthread_mutex_lock(&reader.lock);
+        buf->full = 0;
+        if (done) reader.stop = 1;
+        pthread_cond_broadcast(&reader.changed);
+        pthread_mutex_unlock(&reader.lock);
+        if (done) break;
+    }
     
-    threads = malloc(sizeof(pthread_t) * actual_threads);
-    ThreadData *thread_data = malloc(sizeof(ThreadData) * actual_threads);
+    // Читатель может ждать в read() данных, которые уже не нужны
+    pthread_cancel(thread);
+    pthread_join(thread, NULL);
     
-    int *results = malloc(sizeof(int) * text_len);
-    int result_count = 0;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double time_sec = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
     
+    if (job->mode == MATCH_EXISTS) {
+        if (emitted == 0) printf("Exists: no\n");
+    } else {
+        if (job->mode != MATCH_COUNT) printf("\n");
+        printf("Found: %zu\n", emitted);
+    }
+    printf("Time: %lf seconds\n", time_sec);
+    printf("Threads used: %d (max: %d)\n", thread_pool_size(pool), MAX_THREADS);
+    printf("Stream: %zu blocks of %zu bytes, %llu bytes read%s\n", blocks, block_size, reader.bytes_read,
+           reader.error ? ", read error" : "");
+    if (job->ac) {
+        printf("Algorithm: aho-corasick (%d patterns, %d states)\n", job->ac->pattern_count, job->ac->state_count);
+    } else if (job->dfa) {
+        printf("Algorithm: dfa (%d states, %d byte classes)\n", job->dfa->live_states, job->dfa->class_count);
+    } else if (job->approx) {
+        printf("Algorithm: shift-or, up to %d mismatches (start offsets)\n", job->approx->k);
+    } else {
+        print_engine(job->engine);
+    }
+    
+    free(reader.tail);
+    free(reader.buffers[0].data);
+    free(reader.buffers[1].data);
+    pthread_mutex_destroy(&reader.lock);
+    pthread_cond_destroy(&reader.changed);
+    return status || reader.error;
+}
+
+int compare_positions(const void *a, const void *b) {
+    size_t x = *(const size_t *)a, y = *(const size_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Построение индекса (-B): суффиксный массив и при with_fm - FM-индекс.
+// Проходы вокруг SA-IS делятся между MAX_THREADS потоками.
+int build_index_mode(const char *text, size_t text_len, const char *path, int with_fm) {
+    ThreadPool *pool = MAX_THREADS > 1 ? thread_pool_create(MAX_THREADS, NULL) : NULL;
     struct timespec start, end;
     clock_gettime(CLOCK_MONOTONIC, &start);
+    int rc = sa_index_build(text, text_len, with_fm, path, pool);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (pool) thread_pool_destroy(pool);
+    if (rc != 0) {
+        printf("Index construction failed\n");
+        return 1;
+    }
     
-    // Распределение работы между потоками
-    // находим базовый размер порции каждого потока
-    // и остаток, который распределяется первыми потоками
-    int chunk_size = (text_len - pattern_len + 1) / actual_threads;
-    int remainder = (text_len - pattern_len + 1) % actual_threads;
-    
-    int current_start = 0;
-    for (int i = 0; i < actual_threads; i++) {
-        thread_data[i].id = i;
-        thread_data[i].text = text;
-        thread_data[i].pattern = pattern;
-        thread_data[i].start = current_start;
+    SaIndex *idx = sa_index_open(path);
+    if (idx == NULL) return 1;
+    printf("Index: %s (%zu bytes, text %zu bytes, %u symbols, SA %u bytes/entry, FM-index %s)\n",
+           path, idx->map_size, text_len, idx->header->sigma, idx->header->sa_width, with_fm ? "yes" : "no");
+    printf("Threads: %d (SA-IS itself is sequential)\n", MAX_THREADS);
+    printf("Time: %lf seconds\n", (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+    sa_index_close(idx);
+    return 0;
+}
+
+// Запросы к готовому индексу (-I): текст не сканируется. С FM-индексом
+// диапазон вхождений ищется за O(m), позиции берутся прямо из SA;
+// без него нужен текст (-f) для двоичного поиска. Переданный текст
+// сверяется с индексом до первого запроса.
+int query_index_mode(const char *path, const char *text, size_t text_len, char **queries, const int *lengths,
+                     int query_count, MatchMode mode, size_t limit) {
+    SaIndex *idx = sa_index_open(path);
+    if (idx == NULL) return 1;
+    if (text != NULL && sa_index_check_text(idx, text, text_len) != 0) {
+        sa_index_close(idx);
+        return 1;
+    }
+    
+    int status = 0;
+    for (int q = 0; q < query_count && status == 0; q++) {
+        if (query_count > 1) {
+            printf("Query: %.*s\n", lengths[q], queries[q]);
+        }
         
-        int chunk = chunk_size + (i < remainder ? 1 : 0);
-        thread_data[i].end = current_start + chunk + pattern_len - 1;
-        if (thread_data[i].end > text_len) thread_data[i].end = text_len;
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
         
-        thread_data[i].pattern_len = pattern_len;
-        thread_data[i].results = results;
-        thread_data[i].result_count = &result_count;
-        thread_data[i].mutex = &mutex;
+        size_t lo, hi;
+        if (sa_index_range(idx, text, queries[q], lengths[q], &lo, &hi) != 0) {
+            printf("Index has no FM-index, text file (-f) is required\n");
+            status = 1;
+            break;
+        }
+        size_t total = hi - lo;
+        size_t *positions = NULL;
+        if (mode != MATCH_COUNT && total > 0) {
+            // SA хранит вхождения в лексикографическом порядке суффиксов - сортируем по позиции
+            positions = malloc(sizeof(size_t) * total);
+            if (positions == NULL) {
+                printf("Out of memory while collecting results\n");
+                status = 1;
+                break;
+            }
+            for (size_t row = lo; row < hi; row++) positions[row - lo] = sa_index_locate(idx, row);
+            qsort(positions, total, sizeof(size_t), compare_positions);
+        }
+        if (mode == MATCH_FIRST_K && total > limit) total = limit;
         
-        current_start += chunk;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double time_sec = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
         
-        pthread_create(&threads[i], NULL, thread_function, &thread_data[i]);
+        if (mode == MATCH_EXISTS) {
+            if (total == 0) printf("Exists: no\n");
+            else printf("Exists: yes (%zu)\n", positions[0]);
+        } else {
+            printf("Found: %zu\n", total);
+            if (mode != MATCH_COUNT) {
+                for (size_t i = 0; i < total; i++) printf("%zu ", positions[i]);
+                printf("\n");
+            }
+        }
+        printf("Time: %lf seconds\n", time_sec);
+        printf("Algorithm: %s\n", idx->header->has_fm ? "fm-index" : "suffix-array");
+        free(positions);
+    }
+    sa_index_close(idx);
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    const char *algorithm = "auto";
+    const char *patterns_file = NULL;
+    const char *text_file = NULL;
+    const char *queries_file = NULL;
+    size_t task_size = SEARCH_TASK_SIZE;
+    size_t block_size = STREAM_BLOCK_SIZE;
+    MatchMode mode = MATCH_ALL;
+    size_t limit = 0;
+    const char *affinity = NULL;
+    const char *index_build = NULL;
+    const char *index_query = NULL;
+    int with_fm = 0;
+    int wildcard = 0;
+    int profile = 0;
+    int approx_k = -1;
+    ApproxMetric approx_metric = APPROX_MISMATCH;
+    int bad_usage = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "a:P:f:q:T:m:A:k:e:B:FI:rb:p")) != -1) {
+        switch (opt) {
+        case 'a':
+            algorithm = optarg;
+            break;
+        case 'P':
+            patterns_file = optarg;
+            break;
+        case 'f':
+            text_file = optarg;
+            break;
+        case 'q':
+            queries_file = optarg;
+            break;
+        case 'T':
+            task_size = strtoull(optarg, NULL, 10);
+            break;
+        case 'm':
+            // all | count | exists | first:K
+            if (strcmp(optarg, "all") == 0) {
+                mode = MATCH_ALL;
+            } else if (strcmp(optarg, "count") == 0) {
+                mode = MATCH_COUNT;
+            } else if (strcmp(optarg, "exists") == 0) {
+                mode = MATCH_EXISTS;
+                limit = 1;
+            } else if (strncmp(optarg, "first:", 6) == 0 && (limit = strtoull(optarg + 6, NULL, 10)) > 0) {
+                mode = MATCH_FIRST_K;
+            } else {
+                bad_usage = 1;
+            }
+            break;
+        case 'A':
+            affinity = optarg;
+            break;
+        case 'k':
+        case 'e':
+            // -k: до K замен, -e: до K правок
+            approx_k = atoi(optarg);
+            approx_metric = opt == 'k' ? APPROX_MISMATCH : APPROX_EDIT;
+            if (approx_k < 0) bad_usage = 1;
+            break;
+        case 'B':
+            index_build = optarg;
+            break;
+        case 'F':
+            with_fm = 1;
+            break;
+        case 'I':
+            index_query = optarg;
+            break;
+        case 'r':
+            wildcard = 1;
+            break;
+        case 'b':
+            block_size = strtoull(optarg, NULL, 10);
+            break;
+        case 'p':
+            profile = 1;
+            break;
+        default:
+            argc = 0;
+            break;
+        }
     }
     
-    for (int i = 0; i < actual_threads; i++) {
-        pthread_join(threads[i], NULL);
+    // Текст берётся из файла (-f) или из аргумента; образец - из аргумента,
+    // набора образцов (-P) или файла запросов (-q, по запросу на строку).
+    // Построению индекса образец не нужен, запросам к индексу - текст (кроме -f без FM).
+    int pattern_from_file = patterns_file || queries_file;
+    // -f - : потоковый поиск в stdin
+    int streaming = text_file && strcmp(text_file, "-") == 0;
+    int text_from_arg = !text_file && !index_query;
+    int pattern_from_arg = !pattern_from_file && !index_build;
+    int positional = 1 + text_from_arg + pattern_from_arg;
+    if (argc - optind != positional || (patterns_file && queries_file) || (patterns_file && approx_k >= 0) ||
+        (index_build && index_query) || ((index_build || index_query) && (patterns_file || approx_k >= 0)) ||
+        (wildcard && (patterns_file || approx_k >= 0 || index_build || index_query)) ||
+        (streaming && (queries_file || index_build || index_query || approx_metric == APPROX_EDIT)) ||
+        (profile && (index_build || index_query)) ||
+        block_size == 0 ||
+        task_size == 0 || bad_usage) {
+        printf("Usage: %s [-a auto|naive|horspool|twoway|kmp] <max_threads> <text> <pattern>\n", argv[0]);
+        printf("       %s [-f <text_file>] [-P <patterns_file> | -q <queries_file>] [-T <task_bytes>]"
+               " [-m all|count|exists|first:K] [-A compact|scatter|<cpu_list>] [-k K | -e K | -r] [-p]"
+               " <max_threads> [text] [pattern]\n", argv[0]);
+        printf("       %s -f - [-b <block_bytes>] [-P <patterns_file>] [-m ...] [-a ... | -k K | -r]"
+               " [-p] <max_threads> [pattern]   (stream from stdin)\n", argv[0]);
+        printf("       %s -B <index_file> [-F] [-f <text_file>] <max_threads> [text]"
+               "   (threads split the passes around sequential SA-IS)\n", argv[0]);
+        printf("       %s -I <index_file> [-f <text_file>] [-q <queries_file>] [-m ...] <max_threads> [pattern]\n",
+               argv[0]);
+        return 1;
     }
     
-    clock_gettime(CLOCK_MONOTONIC, &end);
-    double time_sec = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    MAX_THREADS = atoi(argv[optind]);
+    int arg = optind + 1;
+    const char *text = text_from_arg ? argv[arg++] : NULL;
+    char *pattern = pattern_from_arg ? argv[arg++] : NULL;
     
-    printf("Found: %d\n", result_count);
-    for (int i = 0; i < result_count; i++) {
-        printf("%d ", results[i]);
+    if (MAX_THREADS <= 0) {
+        printf("Thread count must be positive\n");
+        return 1;
     }
-    printf("\n");
     
-    printf("Time: %lf seconds\n", time_sec);
-    printf("Threads used: %d (max: %d)\n", actual_threads, MAX_THREADS);
+    size_t text_len = 0;
+    if (streaming) {
+        // Длина потока заранее неизвестна: проверки длины образца относятся к блокам
+        text_len = SIZE_MAX;
+    } else if (text_file) {
+        text = map_text_file(text_file, &text_len);
+        if (text == NULL) {
+            return 1;
+        }
+    } else if (text) {
+        text_len = strlen(text);
+    }
+    
+    if (index_build || index_query) {
+        int status;
+        if (index_build) {
+            status = build_index_mode(text, text_len, index_build, with_fm);
+        } else if (queries_file) {
+            char *buffer;
+            char **queries;
+            int *query_lengths;
+            int count = load_patterns(queries_file, &buffer, &queries, &query_lengths);
+            if (count <= 0) {
+                printf("No patterns loaded from %s\n", queries_file);
+                return 1;
+            }
+            status = query_index_mode(index_query, text, text_len, queries, query_lengths, count, mode, limit);
+            free(buffer);
+            free(queries);
+            free(query_lengths);
+        } else {
+            int length = (int)strlen(pattern);
+            status = query_index_mode(index_query, text, text_len, &pattern, &length, 1, mode, limit);
+        }
+        if (text_file && text_len > 0) munmap((void *)text, text_len);
+        return status;
+    }
+    
+    AhoCorasick *ac = NULL;
+    char *patterns_buffer = NULL;
+    char **patterns = NULL;
+    int *lengths = NULL;
+    int query_count = 1;
+    
+    // min_len определяет число стартовых позиций, max_len - перекрытие кусков
+    size_t min_len;
+    if (pattern_from_file) {
+        const char *path = patterns_file ? patterns_file : queries_file;
+        int count = load_patterns(path, &patterns_buffer, &patterns, &lengths);
+        if (count <= 0) {
+            printf("No patterns loaded from %s\n", path);
+            return 1;
+        }
+        if (patterns_file) {
+            ac = ac_build((const char *const *)patterns, lengths, count);
+            if (ac == NULL) {
+                printf("Automaton construction failed\n");
+                return 1;
+            }
+            min_len = ac->min_len;
+        } else {
+            query_count = count;
+            min_len = lengths[0];
+            for (int i = 1; i < count; i++) {
+                if ((size_t)lengths[i] < min_len) min_len = lengths[i];
+            }
+        }
+    } else {
+        min_len = strlen(pattern);
+    }
+    
+    if (min_len == 0) {
+        printf("Pattern must not be empty\n");
+        return 1;
+    }
+    if (approx_k >= 0 && (size_t)approx_k >= min_len) {
+        printf("Number of differences must be less than pattern length\n");
+        return 1;
+    }
+    // С правками вхождение может быть короче образца на k байт
+    if (approx_k >= 0 && approx_metric == APPROX_EDIT) {
+        min_len -= approx_k;
+    }
+    // Длина вхождения шаблона известна только после компиляции
+    if (wildcard) {
+        min_len = 1;
+    }
+    
+    if (min_len > text_len) {
+        printf("Pattern longer than text\n");
+        return 1;
+    }
+    
+    // Пул создаётся один раз и обслуживает все запросы
+    size_t positions = text_len - min_len + 1;
+    int actual_threads = (positions < (size_t)MAX_THREADS) ? (int)positions : MAX_THREADS;
+    
+    // Привязка потоков к процессорам по топологии из sysfs
+    CpuTopology topo = {0};
+    int *cpus = NULL;
+    if (affinity) {
+        cpus = malloc(sizeof(int) * actual_threads);
+        if (cpus == NULL || cpu_topology_load(&topo) != 0 ||
+            cpu_affinity_plan(&topo, affinity, actual_threads, cpus) != 0) {
+            printf("Cannot apply affinity policy: %s\n", affinity);
+            return 1;
+        }
+    }
+    
+    ThreadPool *pool = thread_pool_create(actual_threads, cpus);
+    if (pool == NULL) {
+        printf("Thread pool creation failed\n");
+        return 1;
+    }
+    
+    // На NUMA-машине страницы отображённого файла размещаются first-touch'ем
+    // на узлах потоков, которые будут их сканировать
+    int first_touch = affinity && text_file && topo.node_count > 1;
+    
+    // Профилирование (-p): счётчики и замеры времени на потоках пула.
+    // Без -p поиск не делает ни одного лишнего системного вызова.
+    PoolWorkerStats *profile_before = NULL;
+    WorkerBytes *scanned = NULL;
+    if (profile) {
+        profile_before = malloc(sizeof(PoolWorkerStats) * thread_pool_size(pool));
+        if (profile_before == NULL ||
+            posix_memalign((void **)&scanned, 64, sizeof(WorkerBytes) * thread_pool_size(pool)) != 0) {
+            printf("Out of memory\n");
+            return 1;
+        }
+        thread_pool_enable_profiling(pool);
+    }
+    
+    int status = 0;
+    for (int q = 0; q < query_count && status == 0; q++) {
+        SearchJob job = {0};
+        job.text = text;
+        job.text_len = text_len;
+        job.mode = mode;
+        job.limit = limit;
+        job.first_touch = first_touch && q == 0;
+        void *prepared = NULL;
+        ApproxPattern *approx = NULL;
+        PatternDfa *dfa = NULL;
+        
+        if (ac) {
+            job.ac = ac;
+            job.min_len = ac->min_len;
+            job.max_len = ac->max_len;
+        } else {
+            const char *query = queries_file ? patterns[q] : pattern;
+            size_t query_len = queries_file ? (size_t)lengths[q] : strlen(pattern);
+            if (queries_file) {
+                printf("Query: %.*s\n", (int)query_len, query);
+            }
+            if (approx_k >= 0) {
+                // Битовые векторы заменяют выбор точного алгоритма
+                approx = approx_prepare(query, query_len, approx_k, approx_metric);
+                if (approx == NULL) {
+                    printf("Pattern preprocessing failed\n");
+                    status = 1;
+                    break;
+                }
+                if (approx_min_len(approx) > text_len) {
+                    printf("Pattern longer than text\n");
+                    approx_release(approx);
+                    continue;
+                }
+                job.approx = approx;
+                job.min_len = approx_min_len(approx);
+                job.max_len = approx_max_len(approx);
+            } else if (wildcard) {
+                const char *error = NULL;
+                dfa = pattern_dfa_compile(query, query_len, &error);
+                if (dfa == NULL) {
+                    printf("Bad pattern: %s\n", error ? error : "out of memory");
+                    status = 1;
+                    break;
+                }
+                if (dfa->min_len > text_len) {
+                    printf("Pattern longer than text\n");
+                    pattern_dfa_free(dfa);
+                    continue;
+                }
+                job.dfa = dfa;
+                job.min_len = dfa->min_len;
+                job.max_len = dfa->max_len;
+            } else if (query_len > text_len) {
+                printf("Pattern longer than text\n");
+                continue;
+            } else if (strcmp(algorithm, "auto") == 0) {
+                job.engine = choose_search_engine(query, query_len);
+            } else {
+                job.engine = find_search_engine(algorithm);
+                if (job.engine == NULL) {
+                    printf("Unknown algorithm: %s\n", algorithm);
+                    status = 1;
+                    break;
+                }
+            }
+            
+            // Предобработка образца выполняется один раз и только читается потоками
+            if (job.engine) {
+                prepared = job.engine->prepare(query, query_len);
+                if (prepared == NULL) {
+                    printf("Pattern preprocessing failed\n");
+                    status = 1;
+                    break;
+                }
+                job.prepared = prepared;
+                job.min_len = job.max_len = query_len;
+            }
+        }
+        
+        struct timespec profile_start, profile_end;
+        if (profile) {
+            for (int i = 0; i < thread_pool_size(pool); i++) {
+                profile_before[i] = thread_pool_worker_stats(pool, i);
+                scanned[i].bytes = 0;
+            }
+            job.scanned = scanned;
+            clock_gettime(CLOCK_MONOTONIC, &profile_start);
+        }
+        
+        if (streaming) {
+            status = run_stream(pool, &job, task_size, block_size);
+        } else {
+            struct timespec start, end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            
+            int rc = run_search(pool, &job, task_size);
+            
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            double time_sec = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+            
+            if (rc != 0) {
+                printf("Out of memory while collecting results\n");
+                status = 1;
+            } else {
+                print_results(&job, time_sec, pool);
+            }
+        }
+        
+        if (profile && status == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &profile_end);
+            print_profile(pool, profile_before, scanned,
+                          (profile_end.tv_sec - profile_start.tv_sec) +
+                          (profile_end.tv_nsec - profile_start.tv_nsec) / 1e9);
+        }
+        
+        if (prepared) job.engine->release(prepared);
+        approx_release(approx);
+        pattern_dfa_free(dfa);
+        free(job.merged);
+    }
     printf("Process PID: %d\n", getpid());
     
-    free(threads);
-    free(thread_data);
-    free(results);
-    return 0;
-}
\ No newline at end of file
+    if (affinity) {
+        printf("Affinity: %s (%d CPUs, %d packages, %d NUMA nodes, first-touch %s)\n",
+               affinity, topo.count, topo.package_count, topo.node_count, first_touch ? "on" : "off");
+        for (int i = 0; i < thread_pool_size(pool); i++) {
+            PoolWorkerStats st = thread_pool_worker_stats(pool, i);
+            printf("Worker %d: pinned CPU %d (node %d), last ran on CPU %d, tasks %zu, steals %zu, migrations %zu\n",
+                   i, st.pinned_cpu, cpu_topology_node(&topo, st.pinned_cpu), st.last_cpu,
+                   st.tasks_done, st.steals, st.migrations);
+        }
+    }
+    
+    thread_pool_destroy(pool);
+    free(profile_before);
+    free(scanned);
+    cpu_topology_free(&topo);
+    free(cpus);
+    ac_free(ac);
+    free(patterns_buffer);
+    free(patterns);
+    free(lengths);
+    if (text_file && !streaming && text_len > 0) munmap((void *)text, text_len);
+    return status;
+}
@@ -0,0 +1,515 @@
+#define _GNU_SOURCE
+#include "pattern_dfa.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DFA_MAX_STATES 4096
+
+// Множество из 256 элементов: байтов или позиций образца
+typedef struct {
+    uint64_t w[4];
+} Set256;
+
+static inline void set_add(Set256 *s, int x) { s->w[x >> 6] |= 1ULL << (x & 63); }
+static inline int set_has(const Set256 *s, int x) { return (s->w[x >> 6] >> (x & 63)) & 1; }
+static inline void set_union(Set256 *a, const Set256 *b) {
+    for (int i = 0; i < 4; i++) a->w[i] |= b->w[i];
+}
+static inline int set_empty(const Set256 *s) { return !(s->w[0] | s->w[1] | s->w[2] | s->w[3]); }
+static inline int set_intersects(const Set256 *a, const Set256 *b) {
+    return ((a->w[0] & b->w[0]) | (a->w[1] & b->w[1]) | (a->w[2] & b->w[2]) | (a->w[3] & b->w[3])) != 0;
+}
+static inline int set_equal(const Set256 *a, const Set256 *b) { return memcmp(a, b, sizeof(Set256)) == 0; }
+
+// ---------- Разбор: конструкция Глушкова ----------
+// Каждый символ образца (байт, ?, класс) - позиция со множеством байтов.
+// follow[p] - позиции, которые могут идти сразу за p.
+
+typedef struct {
+    const unsigned char *p;
+    size_t len;
+    size_t i;
+    int count;
+    Set256 bytes[DFA_MAX_POSITIONS];
+    Set256 follow[DFA_MAX_POSITIONS];
+    const char *error;
+} Parser;
+
+typedef struct {
+    Set256 first;
+    Set256 last;
+    int nullable;
+    size_t min_len;
+    size_t max_len;
+} Fragment;
+
+static int new_position(Parser *ps, const Set256 *bytes, Fragment *out) {
+    if (ps->count == DFA_MAX_POSITIONS) {
+        ps->error = "pattern has too many positions";
+        return -1;
+    }
+    int pos = ps->count++;
+    ps->bytes[pos] = *bytes;
+    memset(out, 0, sizeof(*out));
+    set_add(&out->first, pos);
+    set_add(&out->last, pos);
+    out->min_len = out->max_len = 1;
+    return 0;
+}
+
+static int parse_class(Parser *ps, Set256 *bytes) {
+    ps->i++;    // '['
+    int negate = 0;
+    if (ps->i < ps->len && ps->p[ps->i] == '^') {
+        negate = 1;
+        ps->i++;
+    }
+    Set256 set = {{0}};
+    int first = 1;
+    while (ps->i < ps->len && (ps->p[ps->i] != ']' || first)) {
+        int lo = ps->p[ps->i++];
+        if (lo == '\\' && ps->i < ps->len) lo = ps->p[ps->i++];
+        int hi = lo;
+        if (ps->i + 1 < ps->len && ps->p[ps->i] == '-' && ps->p[ps->i + 1] != ']') {
+            hi = ps->p[ps->i + 1];
+            ps->i += 2;
+            if (hi == '\\' && ps->i < ps->len) hi = ps->p[ps->i++];
+            if (hi < lo) {
+                ps->error = "bad character range";
+                return -1;
+            }
+        }
+        for (int c = lo; c <= hi; c++) set_add(&set, c);
+        first = 0;
+    }
+    if (ps->i == ps->len) {
+        ps->error = "unterminated character class";
+        return -1;
+    }
+    ps->i++;    // ']'
+    if (negate) {
+        for (int i = 0; i < 4; i++) set.w[i] = ~set.w[i];
+    }
+    *bytes = set;
+    return 0;
+}
+
+static void concat(Parser *ps, Fragment *a, const Fragment *b) {
+    for (int q = 0; q < ps->count; q++) {
+        if (set_has(&a->last, q)) set_union(&ps->follow[q], &b->first);
+    }
+    if (a->nullable) set_union(&a->first, &b->first);
+    Set256 last = b->last;
+    if (b->nullable) set_union(&last, &a->last);
+    a->last = last;
+    a->nullable = a->nullable && b->nullable;
+    a->min_len += b->min_len;
+    a->max_len += b->max_len;
+}
+
+static int parse_alternation(Parser *ps, Fragment *out);
+
+static int parse_sequence(Parser *ps, int in_group, Fragment *out) {
+    memset(out, 0, sizeof(*out));
+    out->nullable = 1;
+    while (ps->i < ps->len) {
+        unsigned char c = ps->p[ps->i];
+        Fragment atom;
+        Set256 bytes = {{0}};
+        if (c == '|' || c == ')') {
+            if (!in_group) {
+                ps->error = c == '|' ? "alternation outside parentheses" : "unbalanced ')'";
+                return -1;
+            }
+            break;
+        }
+        if (c == '(') {
+            if (in_group) {
+                ps->error = "nested groups are not supported";
+                return -1;
+            }
+            ps->i++;
+            if (parse_alternation(ps, &atom) != 0) return -1;
+            if (ps->i == ps->len || ps->p[ps->i] != ')') {
+                ps->error = "missing ')'";
+                return -1;
+            }
+            ps->i++;
+        } else {
+            if (c == '?') {
+                memset(&bytes, 0xFF, sizeof(bytes));
+                ps->i++;
+            } else if (c == '[') {
+                if (parse_class(ps, &bytes) != 0) return -1;
+            } else {
+                if (c == '\\') {
+                    if (++ps->i == ps->len) {
+                        ps->error = "trailing backslash";
+                        return -1;
+                    }
+                    c = ps->p[ps->i];
+                }
+                set_add(&bytes, c);
+                ps->i++;
+            }
+            if (new_position(ps, &bytes, &atom) != 0) return -1;
+        }
+        concat(ps, out, &atom);
+    }
+    return 0;
+}
+
+static int parse_alternation(Parser *ps, Fragment *out) {
+    if (parse_sequence(ps, 1, out) != 0) return -1;
+    while (ps->i < ps->len && ps->p[ps->i] == '|') {
+        ps->i++;
+        Fragment alt;
+        if (parse_sequence(ps, 1, &alt) != 0) return -1;
+        set_union(&out->first, &alt.first);
+        set_union(&out->last, &alt.last);
+        out->nullable = out->nullable || alt.nullable;
+        if (alt.min_len < out->min_len) out->min_len = alt.min_len;
+        if (alt.max_len > out->max_len) out->max_len = alt.max_len;
+    }
+    return 0;
+}
+
+// ---------- ДКА ----------
+
+// Классы байтов: байты, которые ни одна позиция не различает, получают общий номер
+static int compute_byte_classes(const Parser *ps, uint8_t *byte_class) {
+    int count = 1;
+    memset(byte_class, 0, 256);
+    for (int pos = 0; pos < ps->count; pos++) {
+        int remap[2][256];
+        memset(remap, -1, sizeof(remap));
+        int next_count = 0;
+        for (int b = 0; b < 256; b++) {
+            int in = set_has(&ps->bytes[pos], b);
+            int *slot = &remap[in][byte_class[b]];
+            if (*slot < 0) *slot = next_count++;
+            byte_class[b] = (uint8_t)*slot;
+        }
+        count = next_count;
+    }
+    return count;
+}
+
+// Переходы детерминизированного (ещё не минимального) автомата:
+// >= 0 - состояние, -1 - тупик, -2 - вхождение найдено
+#define RAW_DEAD (-1)
+#define RAW_ACCEPT (-2)
+#define RAW_FULL (-3)       // Превышен предел числа состояний
+
+typedef struct {
+    Set256 *sets;       // Позиции, только что прочитанные в состоянии (у начального - пусто)
+    int32_t *next;
+    uint8_t *accept;    // Для неякорного автомата: множество содержит конечную позицию
+    int count;
+} RawDfa;
+
+static int find_or_add_state(RawDfa *raw, const Set256 *set, int class_count, int accept) {
+    // Состояние 0 - начальное, его пустое множество особое: не сравниваем с ним
+    for (int s = 1; s < raw->count; s++) {
+        if (set_equal(&raw->sets[s], set)) return s;
+    }
+    if (raw->count == DFA_MAX_STATES) return RAW_FULL;
+    int s = raw->count++;
+    raw->sets[s] = *set;
+    raw->accept[s] = (uint8_t)accept;
+    for (int c = 0; c < class_count; c++) raw->next[(size_t)s * class_count + c] = RAW_DEAD;
+    return s;
+}
+
+// Якорный автомат проверяет вхождение с заданного начала и останавливается
+// на первом совпадении. Неякорный (unanchored) на каждом шаге заново допускает
+// начало вхождения и продолжает после совпадений: так за один проход
+// находятся все концы вхождений.
+static int build_raw_dfa(const Parser *ps, const Fragment *root, const uint8_t *byte_class, int class_count,
+                         int unanchored, RawDfa *raw) {
+    raw->sets = malloc(sizeof(Set256) * DFA_MAX_STATES);
+    raw->next = malloc(sizeof(int32_t) * DFA_MAX_STATES * class_count);
+    raw->accept = calloc(DFA_MAX_STATES, 1);
+    if (!raw->sets || !raw->next || !raw->accept) return -1;
+
+    // Представитель каждого класса байтов
+    int representative[256];
+    for (int b = 255; b >= 0; b--) representative[byte_class[b]] = b;
+
+    raw->count = 1;
+    memset(&raw->sets[0], 0, sizeof(Set256));
+    for (int s = 0; s < raw->count; s++) {
+        // Кандидаты на следующую позицию
+        Set256 reachable = {{0}};
+        if (s == 0 || unanchored) {
+            reachable = root->first;
+        }
+        if (s != 0) {
+            for (int q = 0; q < ps->count; q++) {
+                if (set_has(&raw->sets[s], q)) set_union(&reachable, &ps->follow[q]);
+            }
+        }
+        for (int c = 0; c < class_count; c++) {
+            Set256 next = {{0}};
+            for (int q = 0; q < ps->count; q++) {
+                if (set_has(&reachable, q) && set_has(&ps->bytes[q], representative[c])) set_add(&next, q);
+            }
+            int32_t target;
+            int accept = set_intersects(&next, &root->last);
+            if (unanchored) {
+                // Пустое множество - то же, что начальное состояние
+                target = set_empty(&next) ? 0 : find_or_add_state(raw, &next, class_count, accept);
+            } else if (set_empty(&next)) {
+                target = RAW_DEAD;
+            } else if (accept) {
+                // Нужен лишь факт вхождения с этого начала - дальше не идём
+                target = RAW_ACCEPT;
+            } else {
+                target = find_or_add_state(raw, &next, class_count, 0);
+            }
+            if (target == RAW_FULL) return -1;
+            raw->next[(size_t)s * class_count + c] = target;
+        }
+    }
+    return 0;
+}
+
+// Минимизация разбиением (Мур): состояния эквивалентны, если у них одинаковый
+// признак принятия и по каждому классу они ведут в эквивалентные.
+// Возвращает число классов эквивалентности.
+static int minimize(const RawDfa *raw, int class_count, int *block) {
+    int n = raw->count;
+    int *next_block = malloc(sizeof(int) * n);
+    int *representative = malloc(sizeof(int) * n);
+    if (!next_block || !representative) {
+        free(next_block);
+        free(representative);
+        return -1;
+    }
+    int blocks = 1;
+    for (int s = 0; s < n; s++) {
+        block[s] = raw->accept[s];
+        if (raw->accept[s]) blocks = 2;
+    }
+    for (;;) {
+        int new_blocks = 0;
+        for (int s = 0; s < n; s++) {
+            int found = -1;
+            for (int b = 0; b < new_blocks && found < 0; b++) {
+                int r = representative[b];
+                if (block[r] != block[s]) continue;
+                int same = 1;
+                for (int c = 0; c < class_count && same; c++) {
+                    int32_t x = raw->next[(size_t)s * class_count + c];
+                    int32_t y = raw->next[(size_t)r * class_count + c];
+                    same = (x < 0 || y < 0) ? x == y : block[x] == block[y];
+                }
+                if (same) found = b;
+            }
+            if (found < 0) {
+                found = new_blocks++;
+                representative[found] = s;
+            }
+            next_block[s] = found;
+        }
+        memcpy(block, next_block, sizeof(int) * n);
+        if (new_blocks == blocks) break;
+        blocks = new_blocks;
+    }
+    free(next_block);
+    free(representative);
+    return blocks;
+}
+
+static void compute_prefilter(PatternDfa *dfa) {
+    int c_count = dfa->class_count;
+    // Байты, с которых может начаться вхождение
+    dfa->first_byte_count = 0;
+    for (int b = 0; b < 256; b++) {
+        dfa->first_byte[b] = dfa->next[dfa->byte_class[b]] != dfa->dead_state;
+        dfa->first_byte_count += dfa->first_byte[b];
+    }
+
+    // Общий префикс: пока из состояния в живое ведёт ровно один байт
+    int state = 0;
+    dfa->prefix_len = 0;
+    while (state < dfa->live_states && dfa->prefix_len < DFA_MAX_PREFIX) {
+        int only = -1, count = 0;
+        for (int b = 0; b < 256 && count <= 1; b++) {
+            if (dfa->next[(size_t)state * c_count + dfa->byte_class[b]] != dfa->dead_state) {
+                only = b;
+                count++;
+            }
+        }
+        if (count != 1) break;
+        dfa->prefix[dfa->prefix_len++] = (char)only;
+        state = dfa->next[(size_t)state * c_count + dfa->byte_class[only]];
+    }
+    dfa->after_prefix = state;
+}
+
+// Построение и минимизация автомата. Для якорного тупик и принятие получают
+// номера blocks и blocks + 1, для неякорного заполняется признак принятия.
+// Возвращает число живых состояний, -1 при нехватке памяти, -2 при слишком большом автомате.
+static int build_minimal_dfa(const Parser *ps, const Fragment *root, const uint8_t *byte_class, int class_count,
+                             int unanchored, int32_t **out_next, uint8_t **out_accept) {
+    RawDfa raw = {0};
+    int *block = NULL;
+    int result = -1;
+    if (build_raw_dfa(ps, root, byte_class, class_count, unanchored, &raw) != 0) {
+        if (raw.sets && raw.next && raw.accept) result = -2;
+        goto done;
+    }
+    block = malloc(sizeof(int) * raw.count);
+    if (!block) goto done;
+    int blocks = minimize(&raw, class_count, block);
+    if (blocks < 0) goto done;
+
+    int32_t *next = malloc(sizeof(int32_t) * blocks * class_count);
+    uint8_t *accept = unanchored ? malloc(blocks) : NULL;
+    if (!next || (unanchored && !accept)) {
+        free(next);
+        free(accept);
+        goto done;
+    }
+    for (int s = 0; s < raw.count; s++) {
+        if (accept) accept[block[s]] = raw.accept[s];
+        for (int c = 0; c < class_count; c++) {
+            int32_t t = raw.next[(size_t)s * class_count + c];
+            next[(size_t)block[s] * class_count + c] =
+                t == RAW_DEAD ? blocks : t == RAW_ACCEPT ? blocks + 1 : block[t];
+        }
+    }
+    *out_next = next;
+    if (out_accept) *out_accept = accept;
+    result = blocks;
+
+done:
+    free(block);
+    free(raw.sets);
+    free(raw.next);
+    free(raw.accept);
+    return result;
+}
+
+PatternDfa *pattern_dfa_compile(const char *pattern, size_t pattern_len, const char **error) {
+    Parser *ps = calloc(1, sizeof(Parser));
+    if (!ps) return NULL;
+    ps->p = (const unsigned char *)pattern;
+    ps->len = pattern_len;
+
+    Fragment root;
+    if (parse_sequence(ps, 0, &root) == 0 && root.nullable) {
+        ps->error = "pattern matches the empty string";
+    }
+    if (ps->error) {
+        if (error) *error = ps->error;
+        free(ps);
+        return NULL;
+    }
+
+    PatternDfa *dfa = calloc(1, sizeof(PatternDfa));
+    if (!dfa) {
+        free(ps);
+        return NULL;
+    }
+    dfa->min_len = root.min_len;
+    dfa->max_len = root.max_len;
+    dfa->class_count = compute_byte_classes(ps, dfa->byte_class);
+
+    // Якорный автомат: проверка кандидатов в начала вхождений
+    int blocks = build_minimal_dfa(ps, &root, dfa->byte_class, dfa->class_count, 0, &dfa->next, NULL);
+    if (blocks < 0) {
+        if (error) *error = blocks == -2 ? "pattern is too complex" : "out of memory";
+        free(ps);
+        pattern_dfa_free(dfa);
+        return NULL;
+    }
+    dfa->live_states = blocks;
+    dfa->dead_state = blocks;
+    dfa->accept_state = blocks + 1;
+    compute_prefilter(dfa);
+
+    // Неякорный автомат может оказаться заметно больше; без него работает отсев по первому байту
+    int scan = build_minimal_dfa(ps, &root, dfa->byte_class, dfa->class_count, 1, &dfa->scan_next,
+                                 &dfa->scan_accept);
+    dfa->scan_states = scan > 0 ? scan : 0;
+
+    free(ps);
+    return dfa;
+}
+
+void pattern_dfa_free(PatternDfa *dfa) {
+    if (!dfa) return;
+    free(dfa->next);
+    free(dfa->scan_next);
+    free(dfa->scan_accept);
+    free(dfa);
+}
+
+// Запуск ДКА с позиции pos из состояния state; 1 - дошли до принимающего
+static inline int run_anchored(const PatternDfa *dfa, const unsigned char *t, size_t pos, size_t end, int state) {
+    const int32_t *next = dfa->next;
+    int classes = dfa->class_count;
+    while (state < dfa->live_states && pos < end) {
+        state = next[(size_t)state * classes + dfa->byte_class[t[pos++]]];
+    }
+    return state == dfa->accept_state;
+}
+
+void pattern_dfa_search(const PatternDfa *dfa, const char *text, size_t start, size_t own_end, size_t end,
+                        MatchBuffer *out) {
+    const unsigned char *t = (const unsigned char *)text;
+
+    if (dfa->prefix_len >= 2 || (dfa->prefix_len == 1 && !dfa->scan_next)) {
+        // Кандидаты - вхождения литерального префикса (memmem/memchr из libc векторизованы)
+        size_t plen = dfa->prefix_len;
+        size_t pos = start;
+        while (pos < own_end && pos + plen <= end) {
+            size_t span = (own_end - pos) + plen - 1;
+            if (pos + span > end) span = end - pos;
+            const unsigned char *hit = plen == 1 ? memchr(t + pos, (unsigned char)dfa->prefix[0], span)
+                                                 : memmem(t + pos, span, dfa->prefix, plen);
+            if (!hit) break;
+            pos = (size_t)(hit - t);
+            if (run_anchored(dfa, t, pos + plen, end, dfa->after_prefix) && match_buffer_push(out, pos)) {
+                return;
+            }
+            pos++;
+        }
+        return;
+    }
+
+    if (dfa->scan_next) {
+        // Один проход неякорного автомата: принимающее состояние после байта pos
+        // значит, что вхождение кончается в pos, а его начало лежит в
+        // [pos + 1 - max_len, pos + 1 - min_len]. Эти начала проверяются якорным
+        // автоматом по возрастанию; checked - первое ещё не проверенное начало.
+        const int32_t *next = dfa->scan_next;
+        const uint8_t *accept = dfa->scan_accept;
+        int classes = dfa->class_count;
+        size_t checked = start;
+        int state = 0;
+        for (size_t pos = start; pos < end; pos++) {
+            state = next[(size_t)state * classes + dfa->byte_class[t[pos]]];
+            if (!accept[state]) continue;
+            size_t lo = pos + 1 >= dfa->max_len ? pos + 1 - dfa->max_len : 0;
+            size_t hi = pos + 1 - dfa->min_len;
+            if (lo < checked) lo = checked;
+            if (hi >= own_end) hi = own_end - 1;
+            for (size_t s = lo; s <= hi; s++) {
+                if (run_anchored(dfa, t, s, end, 0) && match_buffer_push(out, s)) return;
+            }
+            if (hi + 1 > checked) checked = hi + 1;
+            if (checked >= own_end) return;
+        }
+        return;
+    }
+
+    // Отсев по множеству первых байтов
+    for (size_t pos = start; pos < own_end; pos++) {
+        if (dfa->first_byte[t[pos]] && run_anchored(dfa, t, pos, end, 0) && match_buffer_push(out, pos)) {
+            return;
+        }
+    }
+}
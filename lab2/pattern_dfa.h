@@ -0,0 +1,52 @@
+#ifndef PATTERN_DFA_H
+#define PATTERN_DFA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "search_kernels.h"
+
+// Образцы с подстановками, компилируемые в минимальный ДКА.
+// Синтаксис (подмножество регулярных выражений без повторений):
+//   ?          - любой байт
+//   [abc] [a-z] [^0-9] - класс символов
+//   (foo|ba?r|)        - альтернатива последовательностей (без вложенных скобок)
+//   \x         - байт x как есть
+// Язык образца конечен, поэтому длина вхождения лежит в [min_len, max_len].
+
+#define DFA_MAX_POSITIONS 256   // Не больше 256 позиций-символов в образце
+#define DFA_MAX_PREFIX 64
+
+typedef struct {
+    int live_states;        // Состояния 0..live_states-1; начальное - 0
+    int dead_state;         // = live_states
+    int accept_state;       // = live_states + 1, конечное: вхождение найдено
+    int class_count;        // Число классов байтов
+    uint8_t byte_class[256];
+    int32_t *next;          // live_states * class_count переходов
+    size_t min_len;
+    size_t max_len;
+    // Предфильтр кандидатов в начала вхождений
+    char prefix[DFA_MAX_PREFIX];    // Общий литеральный префикс всех строк языка
+    size_t prefix_len;
+    int after_prefix;       // Состояние ДКА после префикса
+    uint8_t first_byte[256];        // 1 - байт может начинать вхождение
+    int first_byte_count;
+    // Неякорный ДКА (любой текст, затем образец) для прохода без префикса:
+    // принимающее состояние означает, что здесь кончается какое-то вхождение.
+    // NULL, если автомат получился слишком большим.
+    int scan_states;
+    int32_t *scan_next;
+    uint8_t *scan_accept;
+} PatternDfa;
+
+// Компиляция образца. При синтаксической ошибке возвращает NULL
+// и пишет причину в error (если не NULL).
+PatternDfa *pattern_dfa_compile(const char *pattern, size_t pattern_len, const char **error);
+void pattern_dfa_free(PatternDfa *dfa);
+
+// Вхождения, начинающиеся в [start, own_end), по возрастанию начала.
+// Читается не дальше end (own_end + max_len - 1 или конец текста).
+void pattern_dfa_search(const PatternDfa *dfa, const char *text, size_t start, size_t own_end, size_t end,
+                        MatchBuffer *out);
+
+#endif
@@ -0,0 +1,62 @@
+#include "perf_counters.h"
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+    const char *name;
+} events[PERF_COUNTER_COUNT] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "llc-misses" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch-misses" },
+};
+
+// Каждое событие открывается отдельно, а не группой: если одно из них
+// не поддерживается (например, в виртуальной машине), остальные работают
+int perf_counters_open(PerfCounters *pc) {
+    int opened = 0;
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        attr.exclude_kernel = 1;    // Достаточно perf_event_paranoid <= 2
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // pid = 0, cpu = -1: вызывающий поток на любом процессоре
+        pc->fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (pc->fds[i] >= 0) opened++;
+    }
+    return opened;
+}
+
+void perf_counters_close(PerfCounters *pc) {
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if (pc->fds[i] >= 0) close(pc->fds[i]);
+        pc->fds[i] = -1;
+    }
+}
+
+void perf_counters_read(const PerfCounters *pc, uint64_t values[PERF_COUNTER_COUNT]) {
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        uint64_t data[3];   // значение, время включения, время счёта
+        values[i] = 0;
+        if (pc->fds[i] < 0 || read(pc->fds[i], data, sizeof(data)) != (ssize_t)sizeof(data)) continue;
+        // Если счётчиков больше, чем регистров PMU, ядро считает по очереди:
+        // экстраполируем на всё время
+        if (data[2] > 0 && data[2] < data[1]) {
+            values[i] = (uint64_t)((double)data[0] * data[1] / data[2]);
+        } else {
+            values[i] = data[0];
+        }
+    }
+}
+
+const char *perf_counter_name(int counter) {
+    return events[counter].name;
+}
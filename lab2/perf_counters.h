@@ -0,0 +1,30 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+
+// Аппаратные счётчики потока через perf_event_open: считаются только
+// события пространства пользователя вызывающего потока.
+enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_COUNTER_COUNT
+};
+
+typedef struct {
+    int fds[PERF_COUNTER_COUNT];    // -1 - событие недоступно
+} PerfCounters;
+
+// Открывает счётчики вызывающего потока. Недоступные события пропускаются;
+// возвращает число открытых счётчиков.
+int perf_counters_open(PerfCounters *pc);
+void perf_counters_close(PerfCounters *pc);
+
+// Текущие значения (с поправкой на мультиплексирование); для недоступных - 0
+void perf_counters_read(const PerfCounters *pc, uint64_t values[PERF_COUNTER_COUNT]);
+
+const char *perf_counter_name(int counter);
+
+#endif
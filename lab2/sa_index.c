@@ -0,0 +1,559 @@
+#include "sa_index.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ---------- SA-IS ----------
+// Строка задаётся массивом символов ширины 1, 2 или 8 байт: на верхнем уровне
+// это коды байтов текста (+1, код 0 - завершающий символ), при рекурсии - имена
+// LMS-подстрок. Последний символ строки - единственный минимальный (0).
+
+typedef struct {
+    const void *s;
+    int width;
+    int64_t n;
+    int64_t k;          // Размер алфавита
+    uint8_t *type;      // 1 - S-тип, 0 - L-тип
+    int64_t *bucket;
+} SaisLevel;
+
+static inline int64_t chr(const SaisLevel *lv, int64_t i) {
+    switch (lv->width) {
+    case 1: return ((const uint8_t *)lv->s)[i];
+    case 2: return ((const uint16_t *)lv->s)[i];
+    default: return ((const int64_t *)lv->s)[i];
+    }
+}
+
+static inline int is_lms(const SaisLevel *lv, int64_t i) {
+    return i > 0 && lv->type[i] && !lv->type[i - 1];
+}
+
+// Границы корзин: начала (end == 0) или концы (end == 1)
+static void get_buckets(const SaisLevel *lv, int end) {
+    memset(lv->bucket, 0, sizeof(int64_t) * lv->k);
+    for (int64_t i = 0; i < lv->n; i++) lv->bucket[chr(lv, i)]++;
+    int64_t sum = 0;
+    for (int64_t c = 0; c < lv->k; c++) {
+        sum += lv->bucket[c];
+        lv->bucket[c] = end ? sum : sum - lv->bucket[c];
+    }
+}
+
+// Индуцированная сортировка: L-суффиксы слева направо, затем S-суффиксы справа налево
+static void induce(const SaisLevel *lv, int64_t *sa) {
+    get_buckets(lv, 0);
+    for (int64_t i = 0; i < lv->n; i++) {
+        int64_t j = sa[i] - 1;
+        if (sa[i] > 0 && !lv->type[j]) sa[lv->bucket[chr(lv, j)]++] = j;
+    }
+    get_buckets(lv, 1);
+    for (int64_t i = lv->n - 1; i >= 0; i--) {
+        int64_t j = sa[i] - 1;
+        if (sa[i] > 0 && lv->type[j]) sa[--lv->bucket[chr(lv, j)]] = j;
+    }
+}
+
+static int sais(const void *s, int width, int64_t n, int64_t k, int64_t *sa) {
+    SaisLevel lv = {s, width, n, k, malloc(n), malloc(sizeof(int64_t) * k)};
+    if (!lv.type || !lv.bucket) {
+        free(lv.type);
+        free(lv.bucket);
+        return -1;
+    }
+
+    lv.type[n - 1] = 1;
+    for (int64_t i = n - 2; i >= 0; i--) {
+        int64_t a = chr(&lv, i), b = chr(&lv, i + 1);
+        lv.type[i] = a < b || (a == b && lv.type[i + 1]);
+    }
+
+    // Шаг 1: сортировка LMS-подстрок
+    get_buckets(&lv, 1);
+    for (int64_t i = 0; i < n; i++) sa[i] = -1;
+    for (int64_t i = 1; i < n; i++) {
+        if (is_lms(&lv, i)) sa[--lv.bucket[chr(&lv, i)]] = i;
+    }
+    induce(&lv, sa);
+
+    // Отсортированные LMS-позиции - в начало SA
+    int64_t n1 = 0;
+    for (int64_t i = 0; i < n; i++) {
+        if (is_lms(&lv, sa[i])) sa[n1++] = sa[i];
+    }
+
+    // Имена LMS-подстрок: одинаковые подстроки получают одинаковое имя.
+    // LMS-позиции отстоят друг от друга хотя бы на 2, поэтому sa[n1 + pos / 2] не пересекаются
+    for (int64_t i = n1; i < n; i++) sa[i] = -1;
+    int64_t name = 0, prev = -1;
+    for (int64_t i = 0; i < n1; i++) {
+        int64_t pos = sa[i];
+        int diff = prev == -1;
+        for (int64_t d = 0; !diff; d++) {
+            if (chr(&lv, pos + d) != chr(&lv, prev + d) || lv.type[pos + d] != lv.type[prev + d]) {
+                diff = 1;
+            } else if (d > 0 && (is_lms(&lv, pos + d) || is_lms(&lv, prev + d))) {
+                break;
+            }
+        }
+        if (diff) {
+            name++;
+            prev = pos;
+        }
+        sa[n1 + pos / 2] = name - 1;
+    }
+    for (int64_t i = n - 1, j = n - 1; i >= n1; i--) {
+        if (sa[i] >= 0) sa[j--] = sa[i];
+    }
+
+    // Шаг 2: суффиксный массив сокращённой строки (рекурсия, если имена не уникальны)
+    int64_t *s1 = sa + n - n1;
+    if (name < n1) {
+        if (sais(s1, 8, n1, name, sa) != 0) {
+            free(lv.type);
+            free(lv.bucket);
+            return -1;
+        }
+    } else {
+        for (int64_t i = 0; i < n1; i++) sa[s1[i]] = i;
+    }
+
+    // Шаг 3: LMS-суффиксы в найденном порядке - по концам корзин, затем индукция
+    for (int64_t i = 1, j = 0; i < n; i++) {
+        if (is_lms(&lv, i)) s1[j++] = i;
+    }
+    for (int64_t i = 0; i < n1; i++) sa[i] = s1[sa[i]];
+    for (int64_t i = n1; i < n; i++) sa[i] = -1;
+    get_buckets(&lv, 1);
+    for (int64_t i = n1 - 1; i >= 0; i--) {
+        int64_t j = sa[i];
+        sa[i] = -1;
+        sa[--lv.bucket[chr(&lv, j)]] = j;
+    }
+    induce(&lv, sa);
+
+    free(lv.type);
+    free(lv.bucket);
+    return 0;
+}
+
+// ---------- Запись индекса ----------
+
+static uint64_t align64(uint64_t offset) {
+    return (offset + 63) & ~(uint64_t)63;
+}
+
+static int write_at(int fd, const void *data, size_t size, uint64_t offset) {
+    const char *p = data;
+    while (size > 0) {
+        ssize_t written = pwrite(fd, p, size, (off_t)offset);
+        if (written < 0) {
+            perror("pwrite");
+            return -1;
+        }
+        p += written;
+        size -= written;
+        offset += written;
+    }
+    return 0;
+}
+
+// Проходы построения вне SA-IS делятся на независимые куски и идут через
+// пул (без пула - по очереди в текущем потоке). Кусок SA/BWT - один
+// суперблок, поэтому относительные счётчики считаются внутри куска,
+// а абсолютные - префиксной суммой по кускам после прохода.
+
+enum { BUILD_CHUNK = 1 << SA_SUPERBLOCK_SHIFT, BUILD_TEXT_CHUNK = 1 << 20 };
+
+typedef struct {
+    const unsigned char *t;
+    size_t text_len;
+    int64_t n;
+    const int16_t *code;
+    int sigma;
+    int width;
+    void *s;
+    const int64_t *sa;
+    int fd;
+    const SaIndexHeader *header;
+    size_t (*freq)[256];        // Гистограмма каждого куска текста
+    uint8_t **buffers;          // Буфер каждого потока
+    uint64_t *chunk_count;      // [кусок][sigma]: символы BWT в куске
+    uint16_t *block;
+    uint64_t primary;
+    int status;
+} BuildJob;
+
+// FNV-1a длины и байтов в равномерно расставленных позициях
+static uint64_t text_sample_hash(const unsigned char *t, size_t text_len) {
+    enum { SAMPLES = 4096 };
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < 8; i++) {
+        hash = (hash ^ ((uint64_t)text_len >> (8 * i) & 0xff)) * 1099511628211ULL;
+    }
+    size_t step = text_len > SAMPLES ? text_len / SAMPLES : 1;
+    for (size_t i = 0; i < text_len; i += step) hash = (hash ^ t[i]) * 1099511628211ULL;
+    return (hash ^ t[text_len - 1]) * 1099511628211ULL;
+}
+
+static void build_run(ThreadPool *pool, size_t task_count, pool_task_fn fn, BuildJob *job) {
+    if (pool) {
+        thread_pool_run(pool, task_count, fn, job);
+        return;
+    }
+    for (size_t task = 0; task < task_count; task++) fn(job, task, 0);
+}
+
+static void build_fail(BuildJob *job) {
+    __atomic_store_n(&job->status, -1, __ATOMIC_RELAXED);
+}
+
+static void freq_task(void *ctx, size_t task, int worker) {
+    (void)worker;
+    BuildJob *job = ctx;
+    size_t begin = task * BUILD_TEXT_CHUNK;
+    size_t end = job->text_len - begin < BUILD_TEXT_CHUNK ? job->text_len : begin + BUILD_TEXT_CHUNK;
+    size_t *freq = job->freq[task];
+    for (size_t i = begin; i < end; i++) freq[job->t[i]]++;
+}
+
+static void encode_task(void *ctx, size_t task, int worker) {
+    (void)worker;
+    BuildJob *job = ctx;
+    size_t begin = task * BUILD_TEXT_CHUNK;
+    size_t end = job->text_len - begin < BUILD_TEXT_CHUNK ? job->text_len : begin + BUILD_TEXT_CHUNK;
+    for (size_t i = begin; i < end; i++) {
+        if (job->width == 1) ((uint8_t *)job->s)[i] = (uint8_t)(job->code[job->t[i]] + 1);
+        else ((uint16_t *)job->s)[i] = (uint16_t)(job->code[job->t[i]] + 1);
+    }
+}
+
+static void sa_write_task(void *ctx, size_t task, int worker) {
+    BuildJob *job = ctx;
+    if (__atomic_load_n(&job->status, __ATOMIC_RELAXED) != 0) return;
+    int64_t base = (int64_t)task * BUILD_CHUNK;
+    int64_t len = job->n - base < BUILD_CHUNK ? job->n - base : BUILD_CHUNK;
+    uint8_t *buffer = job->buffers[worker];
+    uint32_t sa_width = job->header->sa_width;
+    for (int64_t i = 0; i < len; i++) {
+        if (sa_width == 4) ((uint32_t *)buffer)[i] = (uint32_t)job->sa[base + i];
+        else ((uint64_t *)buffer)[i] = (uint64_t)job->sa[base + i];
+    }
+    if (write_at(job->fd, buffer, (size_t)len * sa_width, job->header->sa_offset + base * sa_width) != 0) {
+        build_fail(job);
+    }
+}
+
+// BWT куска и счётчики occ относительно его начала
+static void bwt_task(void *ctx, size_t task, int worker) {
+    BuildJob *job = ctx;
+    if (__atomic_load_n(&job->status, __ATOMIC_RELAXED) != 0) return;
+    int64_t base = (int64_t)task * BUILD_CHUNK;
+    int64_t len = job->n - base < BUILD_CHUNK ? job->n - base : BUILD_CHUNK;
+    uint8_t *buffer = job->buffers[worker];
+    int sigma = job->sigma;
+    uint64_t *running = job->chunk_count + task * sigma;
+    for (int64_t i = 0; i < len; i++) {
+        int64_t row = base + i;
+        // Контрольные точки считают символы строго до row
+        if ((row & ((1 << SA_BLOCK_SHIFT) - 1)) == 0) {
+            for (int c = 0; c < sigma; c++) {
+                job->block[(row >> SA_BLOCK_SHIFT) * sigma + c] = (uint16_t)running[c];
+            }
+        }
+        int64_t pos = job->sa[row];
+        if (pos == 0) {
+            job->primary = (uint64_t)row;
+            buffer[i] = 0;
+        } else {
+            buffer[i] = (uint8_t)job->code[job->t[pos - 1]];
+            running[buffer[i]]++;
+        }
+    }
+    // Строка n (конец BWT) внутри суперблока последнего куска
+    int64_t row = job->n;
+    if (base + len == row && (row & ((1 << SA_SUPERBLOCK_SHIFT) - 1)) != 0 &&
+        (row & ((1 << SA_BLOCK_SHIFT) - 1)) == 0) {
+        for (int c = 0; c < sigma; c++) {
+            job->block[(row >> SA_BLOCK_SHIFT) * sigma + c] = (uint16_t)running[c];
+        }
+    }
+    if (write_at(job->fd, buffer, (size_t)len, job->header->bwt_offset + base) != 0) build_fail(job);
+}
+
+int sa_index_build(const char *text, size_t text_len, int with_fm, const char *path, ThreadPool *pool) {
+    const unsigned char *t = (const unsigned char *)text;
+    int64_t n = (int64_t)text_len + 1;
+    if (text_len == 0) {
+        fprintf(stderr, "Cannot index an empty text\n");
+        return -1;
+    }
+    BuildJob job = {.t = t, .text_len = text_len, .n = n};
+    int workers = pool ? thread_pool_size(pool) : 1;
+    size_t text_tasks = (text_len + BUILD_TEXT_CHUNK - 1) / BUILD_TEXT_CHUNK;
+    size_t row_tasks = ((size_t)n + BUILD_CHUNK - 1) / BUILD_CHUNK;
+
+    // Сжатие алфавита до встречающихся байтов
+    SaIndexHeader header = {0};
+    int16_t code[256];
+    size_t freq[256] = {0};
+    job.freq = calloc(text_tasks, sizeof(*job.freq));
+    if (!job.freq) return -1;
+    build_run(pool, text_tasks, freq_task, &job);
+    for (size_t task = 0; task < text_tasks; task++) {
+        for (int c = 0; c < 256; c++) freq[c] += job.freq[task][c];
+    }
+    free(job.freq);
+    int sigma = 0;
+    for (int c = 0; c < 256; c++) code[c] = freq[c] ? sigma++ : -1;
+    job.code = code;
+    job.sigma = sigma;
+
+    // Строка для SA-IS: коды + 1 и завершающий 0. При 256 различных байтах не влезает в байт.
+    int width = sigma < 256 ? 1 : 2;
+    void *s = malloc((size_t)n * width);
+    int64_t *sa = malloc(sizeof(int64_t) * (size_t)n);
+    if (!s || !sa) {
+        free(s);
+        free(sa);
+        return -1;
+    }
+    job.width = width;
+    job.s = s;
+    build_run(pool, text_tasks, encode_task, &job);
+    if (width == 1) ((uint8_t *)s)[text_len] = 0;
+    else ((uint16_t *)s)[text_len] = 0;
+
+    // Сама рекурсия SA-IS последовательна
+    int rc = sais(s, width, n, sigma + 1, sa);
+    free(s);
+    if (rc != 0) {
+        free(sa);
+        return -1;
+    }
+    job.sa = sa;
+
+    // Раскладка файла
+    memcpy(header.magic, SA_INDEX_MAGIC, 8);
+    header.text_len = text_len;
+    header.text_hash = text_sample_hash(t, text_len);
+    header.sa_width = (uint64_t)n <= UINT32_MAX ? 4 : 8;
+    header.sigma = (uint32_t)sigma;
+    header.has_fm = with_fm ? 1 : 0;
+    size_t supers = ((size_t)n >> SA_SUPERBLOCK_SHIFT) + 1;
+    size_t blocks = ((size_t)n >> SA_BLOCK_SHIFT) + 1;
+    uint64_t offset = align64(sizeof(SaIndexHeader));
+    header.sa_offset = offset;
+    offset = align64(offset + (uint64_t)n * header.sa_width);
+    header.code_offset = offset;
+    offset = align64(offset + sizeof(code));
+    header.count_offset = offset;
+    offset = align64(offset + sizeof(uint64_t) * (sigma + 1));
+    if (with_fm) {
+        header.bwt_offset = offset;
+        offset = align64(offset + (uint64_t)n);
+        header.super_offset = offset;
+        offset = align64(offset + sizeof(uint64_t) * supers * sigma);
+        header.block_offset = offset;
+        offset = align64(offset + sizeof(uint16_t) * blocks * sigma);
+    }
+    header.file_size = offset;
+    job.header = &header;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("open");
+        free(sa);
+        return -1;
+    }
+    job.fd = fd;
+    if (ftruncate(fd, (off_t)header.file_size) != 0) {
+        perror("ftruncate");
+        job.status = -1;
+    }
+
+    // C[c]: строка 0 - пустой суффикс, затем суффиксы по первому символу
+    uint64_t count[257];
+    count[0] = 1;
+    for (int c = 0, j = 0; c < 256; c++) {
+        if (code[c] >= 0) {
+            count[j + 1] = count[j] + freq[c];
+            j++;
+        }
+    }
+
+    // SA и BWT пишутся кусками через буферы потоков
+    job.buffers = calloc((size_t)workers, sizeof(uint8_t *));
+    uint64_t *super = with_fm ? calloc(supers * sigma, sizeof(uint64_t)) : NULL;
+    job.block = with_fm ? calloc(blocks * sigma, sizeof(uint16_t)) : NULL;
+    job.chunk_count = with_fm ? calloc(row_tasks * sigma, sizeof(uint64_t)) : NULL;
+    if (!job.buffers || (with_fm && (!super || !job.block || !job.chunk_count))) job.status = -1;
+    for (int w = 0; job.status == 0 && w < workers; w++) {
+        job.buffers[w] = malloc((size_t)BUILD_CHUNK * 8);
+        if (!job.buffers[w]) job.status = -1;
+    }
+
+    if (job.status == 0) build_run(pool, row_tasks, sa_write_task, &job);
+
+    if (job.status == 0 && with_fm) {
+        build_run(pool, row_tasks, bwt_task, &job);
+        // Абсолютные счётчики суперблоков, включая строку n, если она начинает новый
+        uint64_t running[256] = {0};
+        for (size_t j = 0; j < supers; j++) {
+            memcpy(super + j * sigma, running, sizeof(uint64_t) * sigma);
+            for (int c = 0; j < row_tasks && c < sigma; c++) running[c] += job.chunk_count[j * sigma + c];
+        }
+        header.primary = job.primary;
+        if (job.status == 0) job.status = write_at(fd, super, sizeof(uint64_t) * supers * sigma, header.super_offset);
+        if (job.status == 0) job.status = write_at(fd, job.block, sizeof(uint16_t) * blocks * sigma, header.block_offset);
+    }
+
+    int status = job.status;
+    if (status == 0) status = write_at(fd, code, sizeof(code), header.code_offset);
+    if (status == 0) status = write_at(fd, count, sizeof(uint64_t) * (sigma + 1), header.count_offset);
+    if (status == 0) status = write_at(fd, &header, sizeof(header), 0);
+
+    for (int w = 0; job.buffers && w < workers; w++) free(job.buffers[w]);
+    free(job.buffers);
+    free(super);
+    free(job.block);
+    free(job.chunk_count);
+    free(sa);
+    if (close(fd) != 0) status = -1;
+    if (status != 0) unlink(path);
+    return status;
+}
+
+// ---------- Запросы ----------
+
+int sa_index_check_text(const SaIndex *idx, const char *text, size_t text_len) {
+    if (text_len != idx->header->text_len) {
+        fprintf(stderr, "Text length %zu does not match the indexed text (%llu bytes)\n",
+                text_len, (unsigned long long)idx->header->text_len);
+        return -1;
+    }
+    if (text_sample_hash((const unsigned char *)text, text_len) != idx->header->text_hash) {
+        fprintf(stderr, "Text does not match the indexed text (checksum differs)\n");
+        return -1;
+    }
+    return 0;
+}
+
+SaIndex *sa_index_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("open");
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SaIndexHeader)) {
+        fprintf(stderr, "%s: not an index file\n", path);
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+
+    const SaIndexHeader *header = map;
+    if (memcmp(header->magic, SA_INDEX_MAGIC, 8) != 0 || header->file_size != (uint64_t)st.st_size) {
+        fprintf(stderr, "%s: not an index file\n", path);
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+
+    SaIndex *idx = malloc(sizeof(SaIndex));
+    if (!idx) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    const char *base = map;
+    idx->map = map;
+    idx->map_size = (size_t)st.st_size;
+    idx->header = header;
+    idx->sa = base + header->sa_offset;
+    idx->code = (const int16_t *)(base + header->code_offset);
+    idx->count = (const uint64_t *)(base + header->count_offset);
+    idx->bwt = header->has_fm ? (const uint8_t *)(base + header->bwt_offset) : NULL;
+    idx->super = header->has_fm ? (const uint64_t *)(base + header->super_offset) : NULL;
+    idx->block = header->has_fm ? (const uint16_t *)(base + header->block_offset) : NULL;
+    return idx;
+}
+
+void sa_index_close(SaIndex *idx) {
+    if (!idx) return;
+    munmap(idx->map, idx->map_size);
+    free(idx);
+}
+
+// Сколько раз код c встречается в BWT[0, row)
+static uint64_t occ(const SaIndex *idx, int c, uint64_t row) {
+    uint32_t sigma = idx->header->sigma;
+    uint64_t result = idx->super[(row >> SA_SUPERBLOCK_SHIFT) * sigma + c] +
+                      idx->block[(row >> SA_BLOCK_SHIFT) * sigma + c];
+    uint64_t from = row & ~(uint64_t)((1 << SA_BLOCK_SHIFT) - 1);
+    for (uint64_t i = from; i < row; i++) {
+        result += idx->bwt[i] == c;
+    }
+    // В строке конца текста стоит код 0 как заглушка
+    if (c == 0 && idx->header->primary >= from && idx->header->primary < row) result--;
+    return result;
+}
+
+// Сравнение суффикса text[pos..] с образцом по первым pattern_len байтам
+static int compare_suffix(const char *text, size_t text_len, size_t pos, const char *pattern, size_t pattern_len) {
+    size_t avail = text_len - pos;
+    size_t len = avail < pattern_len ? avail : pattern_len;
+    int diff = memcmp(text + pos, pattern, len);
+    if (diff != 0) return diff;
+    return avail < pattern_len ? -1 : 0;
+}
+
+int sa_index_range(const SaIndex *idx, const char *text, const char *pattern, size_t pattern_len,
+                   size_t *lo, size_t *hi) {
+    const SaIndexHeader *header = idx->header;
+    const unsigned char *p = (const unsigned char *)pattern;
+
+    if (header->has_fm) {
+        // Обратный поиск: на шаге i диапазон строк, начинающихся с p[i..m)
+        uint64_t l = 0, h = header->text_len + 1;
+        for (size_t i = pattern_len; i-- > 0 && l < h;) {
+            int c = idx->code[p[i]];
+            if (c < 0) {
+                l = h = 0;
+                break;
+            }
+            l = idx->count[c] + occ(idx, c, l);
+            h = idx->count[c] + occ(idx, c, h);
+        }
+        *lo = (size_t)l;
+        *hi = (size_t)(l < h ? h : l);
+        return 0;
+    }
+
+    if (text == NULL) return -1;
+    // Двоичный поиск: первая строка >= образца и первая строка, не начинающаяся с него
+    size_t n = header->text_len;
+    size_t left = 1, right = n + 1;
+    while (left < right) {
+        size_t mid = left + (right - left) / 2;
+        if (compare_suffix(text, n, sa_index_locate(idx, mid), pattern, pattern_len) < 0) left = mid + 1;
+        else right = mid;
+    }
+    *lo = left;
+    right = n + 1;
+    while (left < right) {
+        size_t mid = left + (right - left) / 2;
+        if (compare_suffix(text, n, sa_index_locate(idx, mid), pattern, pattern_len) <= 0) left = mid + 1;
+        else right = mid;
+    }
+    *hi = left;
+    return 0;
+}
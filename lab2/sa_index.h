@@ -0,0 +1,75 @@
+#ifndef SA_INDEX_H
+#define SA_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "thread_pool.h"
+
+// Постоянный индекс текста: суффиксный массив и (по желанию) FM-индекс.
+// Файл индекса состоит из заголовка и секций, выровненных по 64 байта,
+// и открывается через mmap без разбора: запросы читают секции на месте.
+
+#define SA_INDEX_MAGIC "L2SAIDX2"
+#define SA_SUPERBLOCK_SHIFT 16   // Абсолютные счётчики occ каждые 65536 строк
+#define SA_BLOCK_SHIFT 7         // Относительные (uint16) каждые 128 строк
+
+typedef struct {
+    char magic[8];
+    uint64_t text_len;
+    uint32_t sa_width;          // 4 или 8 байт на элемент SA
+    uint32_t sigma;             // Число различных байтов текста
+    uint32_t has_fm;
+    uint32_t reserved;
+    uint64_t primary;           // Строка BWT, где стоит конец текста
+    uint64_t text_hash;         // Контрольная сумма текста (см. sa_index_check_text)
+    uint64_t sa_offset;         // SA: text_len + 1 элементов (строка 0 - пустой суффикс)
+    uint64_t code_offset;       // int16_t[256]: байт -> код 0..sigma-1 или -1
+    uint64_t count_offset;      // uint64_t[sigma + 1]: C[c] - первая строка суффиксов на c
+    uint64_t bwt_offset;        // uint8_t[text_len + 1]: коды BWT
+    uint64_t super_offset;      // uint64_t[суперблоки][sigma]
+    uint64_t block_offset;      // uint16_t[блоки][sigma]
+    uint64_t file_size;
+} SaIndexHeader;
+
+typedef struct {
+    void *map;
+    size_t map_size;
+    const SaIndexHeader *header;
+    const void *sa;
+    const int16_t *code;
+    const uint64_t *count;
+    const uint8_t *bwt;
+    const uint64_t *super;
+    const uint16_t *block;
+} SaIndex;
+
+// Строит суффиксный массив алгоритмом SA-IS (и FM-индекс при with_fm)
+// и записывает индекс в path. Гистограмма, кодирование текста, запись SA
+// и BWT с контрольными точками идут через pool (NULL - в текущем потоке);
+// сама рекурсия SA-IS последовательна. Возвращает -1 при ошибке.
+int sa_index_build(const char *text, size_t text_len, int with_fm, const char *path, ThreadPool *pool);
+
+// Открывает индекс через mmap. Возвращает NULL при ошибке.
+SaIndex *sa_index_open(const char *path);
+void sa_index_close(SaIndex *idx);
+
+// Проверяет, что text - тот же текст, по которому строился индекс: длина
+// и контрольная сумма по выборке из 4096 равномерно расставленных байтов
+// (дёшево, без сканирования всего текста). Иначе печатает причину и
+// возвращает -1: двоичный поиск по SA с чужим текстом выходит за его конец.
+int sa_index_check_text(const SaIndex *idx, const char *text, size_t text_len);
+
+// Диапазон строк SA [lo, hi), суффиксы которых начинаются с pattern.
+// С FM-индексом - обратный поиск за O(m) без текста, иначе двоичный
+// поиск по SA со сравнением с text (должен быть тем же текстом).
+// Возвращает -1, если нужен текст, а text == NULL.
+int sa_index_range(const SaIndex *idx, const char *text, const char *pattern, size_t pattern_len,
+                   size_t *lo, size_t *hi);
+
+// Позиция в тексте суффикса из строки row
+static inline size_t sa_index_locate(const SaIndex *idx, size_t row) {
+    if (idx->header->sa_width == 4) return ((const uint32_t *)idx->sa)[row];
+    return (size_t)((const uint64_t *)idx->sa)[row];
+}
+
+#endif
@@ -0,0 +1,280 @@
+#include "search_engine.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ===== Наивный поиск (векторное ядро из search_kernels.c) =====
+
+typedef struct {
+    const char *pattern;
+    size_t pattern_len;
+    search_kernel_fn kernel;
+} NaivePrepared;
+
+static void *naive_prepare(const char *pattern, size_t pattern_len) {
+    NaivePrepared *p = malloc(sizeof(NaivePrepared));
+    if (!p) return NULL;
+    p->pattern = pattern;
+    p->pattern_len = pattern_len;
+    p->kernel = select_search_kernel(NULL);
+    return p;
+}
+
+static void naive_engine_search(const void *prepared, const char *text, size_t start, size_t end,
+                                MatchBuffer *out) {
+    const NaivePrepared *p = prepared;
+    p->kernel(text, p->pattern, start, end, p->pattern_len, out);
+}
+
+// ===== Бойер–Мур–Хорспул =====
+
+typedef struct {
+    const unsigned char *pattern;
+    size_t pattern_len;
+    size_t shift[256];    // Сдвиг по последнему символу окна
+} HorspoolPrepared;
+
+static void *horspool_prepare(const char *pattern, size_t pattern_len) {
+    HorspoolPrepared *p = malloc(sizeof(HorspoolPrepared));
+    if (!p) return NULL;
+    p->pattern = (const unsigned char *)pattern;
+    p->pattern_len = pattern_len;
+    for (int c = 0; c < 256; c++) {
+        p->shift[c] = pattern_len;
+    }
+    for (size_t i = 0; i + 1 < pattern_len; i++) {
+        p->shift[(unsigned char)pattern[i]] = pattern_len - 1 - i;
+    }
+    return p;
+}
+
+static void horspool_search(const void *prepared, const char *text, size_t start, size_t end,
+                            MatchBuffer *out) {
+    const HorspoolPrepared *p = prepared;
+    const unsigned char *t = (const unsigned char *)text;
+    const size_t m = p->pattern_len;
+    const unsigned char last = p->pattern[m - 1];
+
+    size_t i = start;
+    while (i + m <= end) {
+        unsigned char c = t[i + m - 1];
+        if (c == last && memcmp(t + i, p->pattern, m - 1) == 0 && match_buffer_push(out, i)) {
+            return;
+        }
+        i += p->shift[c];
+    }
+}
+
+// ===== Two-Way (Крошмор–Перрен) =====
+
+typedef struct {
+    const unsigned char *pattern;
+    ptrdiff_t pattern_len;
+    ptrdiff_t ell;      // Позиция критической факторизации (последний индекс левой части)
+    ptrdiff_t per;      // Период (или сдвиг для непериодического случая)
+    int periodic;       // 1 - левая часть является суффиксом периода, нужна "память"
+} TwoWayPrepared;
+
+// Максимальный суффикс по прямому (reverse = 0) или обратному порядку символов
+static ptrdiff_t maximal_suffix(const unsigned char *x, ptrdiff_t m, ptrdiff_t *period, int reverse) {
+    ptrdiff_t ms = -1, j = 0, k = 1, p = 1;
+    while (j + k < m) {
+        unsigned char a = x[j + k];
+        unsigned char b = x[ms + k];
+        if (reverse ? a > b : a < b) {
+            j += k;
+            k = 1;
+            p = j - ms;
+        } else if (a == b) {
+            if (k != p) {
+                k++;
+            } else {
+                j += p;
+                k = 1;
+            }
+        } else {
+            ms = j;
+            j = ms + 1;
+            k = p = 1;
+        }
+    }
+    *period = p;
+    return ms;
+}
+
+static void *twoway_prepare(const char *pattern, size_t pattern_len) {
+    TwoWayPrepared *p = malloc(sizeof(TwoWayPrepared));
+    if (!p) return NULL;
+    const unsigned char *x = (const unsigned char *)pattern;
+    p->pattern = x;
+    p->pattern_len = pattern_len;
+
+    ptrdiff_t per1, per2;
+    ptrdiff_t i = maximal_suffix(x, p->pattern_len, &per1, 0);
+    ptrdiff_t j = maximal_suffix(x, p->pattern_len, &per2, 1);
+    if (i > j) {
+        p->ell = i;
+        p->per = per1;
+    } else {
+        p->ell = j;
+        p->per = per2;
+    }
+
+    if (memcmp(x, x + p->per, p->ell + 1) == 0) {
+        p->periodic = 1;
+    } else {
+        p->periodic = 0;
+        ptrdiff_t left = p->ell + 1;
+        ptrdiff_t right = p->pattern_len - p->ell - 1;
+        p->per = (left > right ? left : right) + 1;
+    }
+    return p;
+}
+
+static void twoway_search(const void *prepared, const char *text, size_t start, size_t end,
+                          MatchBuffer *out) {
+    const TwoWayPrepared *p = prepared;
+    const unsigned char *x = p->pattern;
+    const ptrdiff_t m = p->pattern_len;
+    const ptrdiff_t ell = p->ell;
+    ptrdiff_t i;
+    size_t j = start;
+
+    if (p->periodic) {
+        ptrdiff_t memory = -1;
+        while (j + (size_t)m <= end) {
+            // Окно текста, приложенное к образцу
+            const unsigned char *y = (const unsigned char *)text + j;
+            i = (ell > memory ? ell : memory) + 1;
+            while (i < m && x[i] == y[i]) i++;
+            if (i >= m) {
+                i = ell;
+                while (i > memory && x[i] == y[i]) i--;
+                if (i <= memory && match_buffer_push(out, j)) {
+                    return;
+                }
+                j += p->per;
+                memory = m - p->per - 1;
+            } else {
+                j += i - ell;
+                memory = -1;
+            }
+        }
+    } else {
+        while (j + (size_t)m <= end) {
+            const unsigned char *y = (const unsigned char *)text + j;
+            i = ell + 1;
+            while (i < m && x[i] == y[i]) i++;
+            if (i >= m) {
+                i = ell;
+                while (i >= 0 && x[i] == y[i]) i--;
+                if (i < 0 && match_buffer_push(out, j)) {
+                    return;
+                }
+                j += p->per;
+            } else {
+                j += i - ell;
+            }
+        }
+    }
+}
+
+// ===== Кнут–Моррис–Пратт =====
+
+typedef struct {
+    const char *pattern;
+    size_t pattern_len;
+    size_t fail[];  // fail[i] - длина наибольшей грани pattern[0..i]
+} KmpPrepared;
+
+static void build_failure(const char *pattern, size_t pattern_len, size_t *fail) {
+    fail[0] = 0;
+    size_t k = 0;
+    for (size_t i = 1; i < pattern_len; i++) {
+        while (k > 0 && pattern[i] != pattern[k]) k = fail[k - 1];
+        if (pattern[i] == pattern[k]) k++;
+        fail[i] = k;
+    }
+}
+
+static void *kmp_prepare(const char *pattern, size_t pattern_len) {
+    KmpPrepared *p = malloc(sizeof(KmpPrepared) + sizeof(size_t) * pattern_len);
+    if (!p) return NULL;
+    p->pattern = pattern;
+    p->pattern_len = pattern_len;
+    build_failure(pattern, pattern_len, p->fail);
+    return p;
+}
+
+static void kmp_search(const void *prepared, const char *text, size_t start, size_t end,
+                       MatchBuffer *out) {
+    const KmpPrepared *p = prepared;
+    const size_t m = p->pattern_len;
+    size_t k = 0;
+    for (size_t i = start; i < end; i++) {
+        while (k > 0 && text[i] != p->pattern[k]) k = p->fail[k - 1];
+        if (text[i] == p->pattern[k]) k++;
+        if (k == m) {
+            if (match_buffer_push(out, i + 1 - m)) {
+                return;
+            }
+            k = p->fail[k - 1];
+        }
+    }
+}
+
+// ===== Таблица реализаций =====
+
+const SearchEngine naive_engine = { "naive", naive_prepare, naive_engine_search, free };
+const SearchEngine horspool_engine = { "horspool", horspool_prepare, horspool_search, free };
+const SearchEngine twoway_engine = { "twoway", twoway_prepare, twoway_search, free };
+const SearchEngine kmp_engine = { "kmp", kmp_prepare, kmp_search, free };
+
+static const SearchEngine *const engines[] = {
+    &naive_engine, &horspool_engine, &twoway_engine, &kmp_engine
+};
+
+const SearchEngine *find_search_engine(const char *name) {
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++) {
+        if (strcmp(engines[i]->name, name) == 0) {
+            return engines[i];
+        }
+    }
+    return NULL;
+}
+
+const SearchEngine *choose_search_engine(const char *pattern, size_t pattern_len) {
+    // Короткие образцы лучше всего ищет векторный фильтр
+    if (pattern_len <= 3) {
+        return &naive_engine;
+    }
+
+    int seen[256] = {0};
+    int distinct = 0;
+    for (size_t i = 0; i < pattern_len; i++) {
+        if (!seen[(unsigned char)pattern[i]]++) distinct++;
+    }
+
+    // Наименьший период образца: маленький период означает повторяющийся образец,
+    // на котором наивный и Хорспул деградируют до O(n*m)
+    size_t *fail = malloc(sizeof(size_t) * pattern_len);
+    size_t period = pattern_len;
+    if (fail) {
+        build_failure(pattern, pattern_len, fail);
+        period = pattern_len - fail[pattern_len - 1];
+        free(fail);
+    }
+
+    if (period <= pattern_len / 2) {
+        return &twoway_engine;
+    }
+    // Малый алфавит (ДНК и т.п.): у Хорспула короткие сдвиги, а фильтр
+    // по первому/последнему байту даёт много ложных кандидатов
+    if (distinct <= 4 && pattern_len >= 32) {
+        return &twoway_engine;
+    }
+    // Богатый алфавит и длинный образец - длинные сдвиги Хорспула
+    if (distinct >= 8 && pattern_len >= 16) {
+        return &horspool_engine;
+    }
+    return &naive_engine;
+}
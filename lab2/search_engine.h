@@ -0,0 +1,28 @@
+#ifndef SEARCH_ENGINE_H
+#define SEARCH_ENGINE_H
+
+#include "search_kernels.h"
+
+// Интерфейс алгоритма поиска одного образца.
+// prepare выполняется один раз в main, результат только читается всеми потоками.
+typedef struct SearchEngine {
+    const char *name;
+    void *(*prepare)(const char *pattern, size_t pattern_len);
+    // Ищет в text[start, end) и дописывает позиции вхождений по возрастанию
+    void (*search)(const void *prepared, const char *text, size_t start, size_t end,
+                   MatchBuffer *out);
+    void (*release)(void *prepared);
+} SearchEngine;
+
+extern const SearchEngine naive_engine;
+extern const SearchEngine horspool_engine;
+extern const SearchEngine twoway_engine;
+extern const SearchEngine kmp_engine;
+
+// Поиск реализации по имени ("naive", "horspool", "twoway", "kmp"), NULL если нет
+const SearchEngine *find_search_engine(const char *name);
+
+// Эвристический выбор алгоритма по длине образца и статистике его алфавита
+const SearchEngine *choose_search_engine(const char *pattern, size_t pattern_len);
+
+#endif
@@ -0,0 +1,127 @@
+#include "search_kernels.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+int match_buffer_grow(MatchBuffer *buf) {
+    size_t new_capacity = buf->capacity ? buf->capacity * 2 : 1024;
+    size_t *grown = realloc(buf->positions, sizeof(size_t) * new_capacity);
+    if (!grown) return -1;
+    buf->positions = grown;
+    buf->capacity = new_capacity;
+    return 0;
+}
+
+void naive_search(const char *text, const char *pattern, size_t start, size_t end,
+                  size_t pattern_len, MatchBuffer *out) {
+    for (size_t i = start; i + pattern_len <= end; i++) {
+        size_t j;
+        for (j = 0; j < pattern_len; j++) {
+            if (text[i + j] != pattern[j]) break;
+        }
+        if (j == pattern_len && match_buffer_push(out, i)) {
+            return;
+        }
+    }
+}
+
+#ifdef HAVE_X86_SIMD
+
+// Проверка кандидатов из битовой маски: первый и последний байт уже совпали,
+// сравниваем только середину образца. Возвращает 1, если поиск нужно прекратить.
+static inline int verify_candidates(const char *text, const char *pattern, size_t base,
+                                     unsigned mask, size_t pattern_len, MatchBuffer *out) {
+    while (mask != 0) {
+        size_t pos = base + __builtin_ctz(mask);
+        if (pattern_len <= 2 ||
+            memcmp(text + pos + 1, pattern + 1, pattern_len - 2) == 0) {
+            if (match_buffer_push(out, pos)) return 1;
+        }
+        mask &= mask - 1;
+    }
+    return 0;
+}
+
+__attribute__((target("sse2")))
+void naive_search_sse2(const char *text, const char *pattern, size_t start, size_t end,
+                       size_t pattern_len, MatchBuffer *out) {
+    const __m128i first = _mm_set1_epi8(pattern[0]);
+    const __m128i last = _mm_set1_epi8(pattern[pattern_len - 1]);
+
+    // Последняя загрузка читает text[i + pattern_len - 1 .. i + pattern_len + 14],
+    // поэтому выходить за end нельзя
+    size_t i = start;
+    for (; i + pattern_len + 15 <= end; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i *)(text + i + pattern_len - 1));
+        __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(block_first, first),
+                                   _mm_cmpeq_epi8(block_last, last));
+        unsigned mask = (unsigned)_mm_movemask_epi8(eq);
+        if (mask != 0 && verify_candidates(text, pattern, i, mask, pattern_len, out)) {
+            return;
+        }
+    }
+
+    // Хвост, не поместившийся в вектор
+    naive_search(text, pattern, i, end, pattern_len, out);
+}
+
+__attribute__((target("avx2")))
+void naive_search_avx2(const char *text, const char *pattern, size_t start, size_t end,
+                       size_t pattern_len, MatchBuffer *out) {
+    const __m256i first = _mm256_set1_epi8(pattern[0]);
+    const __m256i last = _mm256_set1_epi8(pattern[pattern_len - 1]);
+
+    size_t i = start;
+    for (; i + pattern_len + 31 <= end; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i *)(text + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i *)(text + i + pattern_len - 1));
+        __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                                      _mm256_cmpeq_epi8(block_last, last));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(eq);
+        if (mask != 0 && verify_candidates(text, pattern, i, mask, pattern_len, out)) {
+            return;
+        }
+    }
+
+    // Остаток добиваем SSE2 (он сам перейдёт на скалярный хвост)
+    naive_search_sse2(text, pattern, i, end, pattern_len, out);
+}
+
+search_kernel_fn select_search_kernel(const char **name) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        if (name) *name = "avx2";
+        return naive_search_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        if (name) *name = "sse2";
+        return naive_search_sse2;
+    }
+    if (name) *name = "scalar";
+    return naive_search;
+}
+
+#else
+
+// На не-x86 платформах векторные ядра сводятся к скалярному
+void naive_search_sse2(const char *text, const char *pattern, size_t start, size_t end,
+                       size_t pattern_len, MatchBuffer *out) {
+    naive_search(text, pattern, start, end, pattern_len, out);
+}
+
+void naive_search_avx2(const char *text, const char *pattern, size_t start, size_t end,
+                       size_t pattern_len, MatchBuffer *out) {
+    naive_search(text, pattern, start, end, pattern_len, out);
+}
+
+search_kernel_fn select_search_kernel(const char **name) {
+    if (name) *name = "scalar";
+    return naive_search;
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef SEARCH_KERNELS_H
+#define SEARCH_KERNELS_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+// Что нужно запросу от поиска
+typedef enum {
+    MATCH_ALL = 0,      // Все позиции
+    MATCH_COUNT,        // Только количество, позиции не хранятся
+    MATCH_EXISTS,       // Достаточно одного вхождения во всём тексте
+    MATCH_FIRST_K       // limit наименьших позиций
+} MatchMode;
+
+// Управление досрочной остановкой. Текст разбит на задачи с номерами по порядку;
+// как только ответ известен, общий cancel_from опускается, и все задачи
+// с номером >= cancel_from прекращают поиск.
+typedef struct {
+    MatchMode mode;
+    size_t limit;                   // Для MATCH_FIRST_K
+    size_t task;                    // Номер задачи, которой принадлежит буфер
+    _Atomic size_t *cancel_from;    // NULL - отмена не используется
+} MatchControl;
+
+static inline int match_control_cancelled(const MatchControl *control) {
+    return control->cancel_from &&
+           atomic_load_explicit(control->cancel_from, memory_order_relaxed) <= control->task;
+}
+
+// Растущий буфер позиций найденных вхождений.
+// Память расходуется пропорционально числу совпадений, а не длине текста.
+typedef struct {
+    size_t *positions;
+    size_t count;
+    size_t capacity;
+    int failed;         // 1 - не хватило памяти, часть позиций потеряна
+    MatchControl control;
+} MatchBuffer;
+
+int match_buffer_grow(MatchBuffer *buf);
+
+// Добавляет вхождение. Ненулевой результат означает, что поиск в этом куске
+// нужно прекратить (ответ уже известен или кончилась память).
+static inline int match_buffer_push(MatchBuffer *buf, size_t pos) {
+    if (match_control_cancelled(&buf->control)) {
+        return 1;
+    }
+    if (buf->control.mode == MATCH_COUNT) {
+        buf->count++;
+        return 0;
+    }
+    if (buf->count == buf->capacity && match_buffer_grow(buf) != 0) {
+        buf->failed = 1;
+        return 1;
+    }
+    buf->positions[buf->count++] = pos;
+    // Позиции в куске идут по возрастанию, поэтому первые limit - наименьшие
+    return buf->control.mode != MATCH_ALL && buf->count >= buf->control.limit;
+}
+
+// Сигнатура ядра поиска: ищет pattern в text[start, end)
+// и дописывает позиции вхождений в out по возрастанию,
+// прекращая поиск, когда match_buffer_push просит остановиться
+typedef void (*search_kernel_fn)(const char *text, const char *pattern, size_t start, size_t end,
+                                 size_t pattern_len, MatchBuffer *out);
+
+// Скалярная реализация (всегда доступна, используется как запасной вариант)
+void naive_search(const char *text, const char *pattern, size_t start, size_t end,
+                  size_t pattern_len, MatchBuffer *out);
+
+// Векторные реализации с фильтром по первому и последнему байту образца
+void naive_search_sse2(const char *text, const char *pattern, size_t start, size_t end,
+                       size_t pattern_len, MatchBuffer *out);
+void naive_search_avx2(const char *text, const char *pattern, size_t start, size_t end,
+                       size_t pattern_len, MatchBuffer *out);
+
+// Выбор самого быстрого ядра, поддерживаемого процессором (по CPUID)
+search_kernel_fn select_search_kernel(const char **name);
+
+#endif
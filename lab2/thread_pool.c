@@ -0,0 +1,325 @@
+#define _GNU_SOURCE
+#include "thread_pool.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Дека потока: диапазон ещё не взятых задач [lo, hi).
+// Владелец берёт с начала (задачи идут по тексту подряд - лучше для кэша),
+// вор забирает верхнюю половину. Выравнивание по строке кэша убирает
+// ложное разделение между деками соседних потоков.
+typedef struct {
+    pthread_mutex_t lock;
+    size_t lo;
+    size_t hi;
+    PoolWorkerStats stats;
+    PerfCounters perf;
+    uint64_t job_busy_ns;   // Время в задачах текущего задания (для idle_ns)
+} __attribute__((aligned(64))) WorkerDeque;
+
+typedef struct {
+    ThreadPool *pool;
+    int id;
+} WorkerArg;
+
+struct ThreadPool {
+    int worker_count;
+    pthread_t *threads;
+    WorkerArg *args;
+    WorkerDeque *deques;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t work_ready;   // Появилось новое задание (или пул закрывается)
+    pthread_cond_t work_done;    // Все потоки закончили текущее задание
+    unsigned long generation;    // Номер текущего задания
+    int active;                  // Сколько потоков ещё работают над заданием
+    int no_steal;                // Текущее задание запрещает перехват
+    int profiling;               // Замерять время задач и читать счётчики
+    int shutdown;
+
+    pool_task_fn fn;
+    void *ctx;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int pop_own(WorkerDeque *deque, size_t *task) {
+    int got = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->lo < deque->hi) {
+        *task = deque->lo++;
+        got = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return got;
+}
+
+// Забирает у первого непустого соседа верхнюю половину его диапазона
+static int steal(ThreadPool *pool, int self) {
+    for (int k = 1; k < pool->worker_count; k++) {
+        WorkerDeque *victim = &pool->deques[(self + k) % pool->worker_count];
+        size_t lo = 0, hi = 0;
+
+        pthread_mutex_lock(&victim->lock);
+        size_t left = victim->hi - victim->lo;
+        if (left > 0) {
+            hi = victim->hi;
+            lo = hi - (left + 1) / 2;
+            victim->hi = lo;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (hi > lo) {
+            WorkerDeque *own = &pool->deques[self];
+            pthread_mutex_lock(&own->lock);
+            own->lo = lo;
+            own->hi = hi;
+            own->stats.steals++;
+            pthread_mutex_unlock(&own->lock);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void *worker_main(void *arg) {
+    WorkerArg *wa = arg;
+    ThreadPool *pool = wa->pool;
+    WorkerDeque *own = &pool->deques[wa->id];
+    unsigned long seen = 0;
+
+    if (own->stats.pinned_cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(own->stats.pinned_cpu, &set);
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (rc != 0) {
+            fprintf(stderr, "Worker %d: cannot pin to CPU %d\n", wa->id, own->stats.pinned_cpu);
+            own->stats.pinned_cpu = -1;
+        }
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&pool->mutex);
+        while (!pool->shutdown && pool->generation == seen) {
+            pthread_cond_wait(&pool->work_ready, &pool->mutex);
+        }
+        if (pool->shutdown) {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+        seen = pool->generation;
+        pool_task_fn fn = pool->fn;
+        void *ctx = pool->ctx;
+        int no_steal = pool->no_steal;
+        int profiling = pool->profiling;
+        pthread_mutex_unlock(&pool->mutex);
+
+        // Счётчики читаются дважды за задание, время - вокруг каждой задачи
+        uint64_t before[PERF_COUNTER_COUNT];
+        if (profiling) {
+            own->job_busy_ns = 0;
+            perf_counters_read(&own->perf, before);
+        }
+
+        // Задачи не порождают новых, поэтому пустые деки у всех означают конец задания
+        size_t task;
+        for (;;) {
+            if (pop_own(own, &task)) {
+                if (profiling) {
+                    uint64_t t0 = now_ns();
+                    fn(ctx, task, wa->id);
+                    own->job_busy_ns += now_ns() - t0;
+                } else {
+                    fn(ctx, task, wa->id);
+                }
+                own->stats.tasks_done++;
+                int cpu = sched_getcpu();
+                if (own->stats.last_cpu >= 0 && cpu != own->stats.last_cpu) {
+                    own->stats.migrations++;
+                }
+                own->stats.last_cpu = cpu;
+            } else if (no_steal || !steal(pool, wa->id)) {
+                break;
+            }
+        }
+
+        if (profiling) {
+            uint64_t after[PERF_COUNTER_COUNT];
+            perf_counters_read(&own->perf, after);
+            for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+                own->stats.counters[i] += after[i] - before[i];
+            }
+            own->stats.busy_ns += own->job_busy_ns;
+        }
+
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->active == 0) {
+            pthread_cond_signal(&pool->work_done);
+        }
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    return NULL;
+}
+
+ThreadPool *thread_pool_create(int worker_count, const int *cpus) {
+    if (worker_count <= 0) return NULL;
+
+    ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+    if (!pool) return NULL;
+    pool->worker_count = worker_count;
+    pool->threads = malloc(sizeof(pthread_t) * worker_count);
+    pool->args = malloc(sizeof(WorkerArg) * worker_count);
+    if (posix_memalign((void **)&pool->deques, 64, sizeof(WorkerDeque) * worker_count) != 0) {
+        pool->deques = NULL;
+    }
+    if (!pool->threads || !pool->args || !pool->deques) {
+        free(pool->threads);
+        free(pool->args);
+        free(pool->deques);
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+    for (int i = 0; i < worker_count; i++) {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+        pool->deques[i].lo = pool->deques[i].hi = 0;
+        pool->deques[i].stats.tasks_done = 0;
+        pool->deques[i].stats.steals = 0;
+        pool->deques[i].stats.pinned_cpu = cpus ? cpus[i] : -1;
+        pool->deques[i].stats.last_cpu = -1;
+        pool->deques[i].stats.migrations = 0;
+        pool->deques[i].stats.busy_ns = 0;
+        pool->deques[i].stats.idle_ns = 0;
+        pool->deques[i].stats.counters_open = 0;
+        pool->deques[i].job_busy_ns = 0;
+        for (int c = 0; c < PERF_COUNTER_COUNT; c++) {
+            pool->deques[i].stats.counters[c] = 0;
+            pool->deques[i].perf.fds[c] = -1;
+        }
+    }
+
+    for (int i = 0; i < worker_count; i++) {
+        pool->args[i].pool = pool;
+        pool->args[i].id = i;
+        if (pthread_create(&pool->threads[i], NULL, worker_main, &pool->args[i]) != 0) {
+            // Оставляем столько потоков, сколько удалось создать
+            pool->worker_count = i;
+            break;
+        }
+    }
+    if (pool->worker_count == 0) {
+        thread_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void thread_pool_initial_range(const ThreadPool *pool, size_t task_count, int worker,
+                               size_t *lo, size_t *hi) {
+    // Непрерывные диапазоны поровну, остаток - первым потокам
+    size_t n = (size_t)pool->worker_count;
+    size_t w = (size_t)worker;
+    size_t base = task_count / n;
+    size_t extra = task_count % n;
+    *lo = w * base + (w < extra ? w : extra);
+    *hi = *lo + base + (w < extra ? 1 : 0);
+}
+
+static void run_job(ThreadPool *pool, size_t task_count, pool_task_fn fn, void *ctx, int no_steal) {
+    int n = pool->worker_count;
+    for (int i = 0; i < n; i++) {
+        pthread_mutex_lock(&pool->deques[i].lock);
+        thread_pool_initial_range(pool, task_count, i, &pool->deques[i].lo, &pool->deques[i].hi);
+        pthread_mutex_unlock(&pool->deques[i].lock);
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    uint64_t start = pool->profiling ? now_ns() : 0;
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->no_steal = no_steal;
+    pool->active = n;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    while (pool->active > 0) {
+        pthread_cond_wait(&pool->work_done, &pool->mutex);
+    }
+    // Потоки ждут следующего задания - их статистику можно менять.
+    // Простой - всё время задания, которое поток провёл не в задачах.
+    if (pool->profiling) {
+        uint64_t wall = now_ns() - start;
+        for (int i = 0; i < n; i++) {
+            uint64_t busy = pool->deques[i].job_busy_ns;
+            pool->deques[i].stats.idle_ns += wall > busy ? wall - busy : 0;
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void thread_pool_run(ThreadPool *pool, size_t task_count, pool_task_fn fn, void *ctx) {
+    if (task_count == 0) return;
+    run_job(pool, task_count, fn, ctx, 0);
+}
+
+void thread_pool_run_each(ThreadPool *pool, pool_task_fn fn, void *ctx) {
+    // Ровно по одной задаче на поток: задача i достаётся потоку i
+    run_job(pool, (size_t)pool->worker_count, fn, ctx, 1);
+}
+
+static void open_counters_task(void *ctx, size_t task, int worker) {
+    (void)task;
+    ThreadPool *pool = ctx;
+    WorkerDeque *own = &pool->deques[worker];
+    own->stats.counters_open = perf_counters_open(&own->perf);
+}
+
+void thread_pool_enable_profiling(ThreadPool *pool) {
+    if (pool->profiling) return;
+    // perf_event_open с pid = 0 привязывает счётчик к вызывающему потоку
+    thread_pool_run_each(pool, open_counters_task, pool);
+    pthread_mutex_lock(&pool->mutex);
+    pool->profiling = 1;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+int thread_pool_size(const ThreadPool *pool) {
+    return pool->worker_count;
+}
+
+PoolWorkerStats thread_pool_worker_stats(const ThreadPool *pool, int worker) {
+    return pool->deques[worker].stats;
+}
+
+void thread_pool_destroy(ThreadPool *pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->worker_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (int i = 0; i < pool->worker_count; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        perf_counters_close(&pool->deques[i].perf);
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free(pool->threads);
+    free(pool->args);
+    free(pool->deques);
+    free(pool);
+}
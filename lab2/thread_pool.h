@@ -0,0 +1,58 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "perf_counters.h"
+
+// Постоянный пул потоков с перехватом работы (work stealing).
+// Потоки создаются один раз и переиспользуются всеми запросами процесса.
+// Задание - это task_count независимых задач с номерами [0, task_count):
+// каждый поток получает свой непрерывный диапазон номеров (свою деку),
+// берёт задачи с начала диапазона, а освободившись, забирает
+// половину оставшегося диапазона у другого потока.
+
+typedef struct ThreadPool ThreadPool;
+
+// Функция задачи: ctx - общий контекст задания, task - номер задачи,
+// worker - номер потока пула, который её выполняет
+typedef void (*pool_task_fn)(void *ctx, size_t task, int worker);
+
+typedef struct {
+    size_t tasks_done;     // Сколько задач выполнил поток за всё время
+    size_t steals;         // Сколько раз он забирал работу у других
+    int pinned_cpu;        // Процессор, к которому привязан поток (-1 - не привязан)
+    int last_cpu;          // Где поток выполнял последнюю задачу
+    size_t migrations;     // Сколько раз процессор менялся между задачами
+    // Заполняются только после thread_pool_enable_profiling
+    uint64_t busy_ns;      // Время внутри задач
+    uint64_t idle_ns;      // Остальное время заданий: перехват, ожидание остальных потоков
+    uint64_t counters[PERF_COUNTER_COUNT];  // Аппаратные счётчики за время заданий
+    int counters_open;     // Сколько счётчиков удалось открыть (0 - нет доступа к PMU)
+} PoolWorkerStats;
+
+// cpus - процессор для каждого потока или NULL (размещение оставляется планировщику)
+ThreadPool *thread_pool_create(int worker_count, const int *cpus);
+
+// Выполняет все задачи и возвращает управление, когда они завершены
+void thread_pool_run(ThreadPool *pool, size_t task_count, pool_task_fn fn, void *ctx);
+
+// Выполняет fn ровно один раз на каждом потоке (task = номер потока), без перехвата.
+// Нужно, когда важно, какой именно поток делает работу (first-touch страниц).
+void thread_pool_run_each(ThreadPool *pool, pool_task_fn fn, void *ctx);
+
+// Диапазон задач [lo, hi), который поток worker получает при начальной раздаче
+void thread_pool_initial_range(const ThreadPool *pool, size_t task_count, int worker,
+                               size_t *lo, size_t *hi);
+
+// Включает профилирование: каждый поток открывает свои счётчики perf_event_open
+// и дальше учитывает время в задачах и вне их. Без этого вызова пул
+// не делает ни одного лишнего системного вызова или замера времени.
+void thread_pool_enable_profiling(ThreadPool *pool);
+
+int thread_pool_size(const ThreadPool *pool);
+PoolWorkerStats thread_pool_worker_stats(const ThreadPool *pool, int worker);
+
+void thread_pool_destroy(ThreadPool *pool);
+
+#endif
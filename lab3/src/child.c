@@ -1,24 +1,94 @@
 #include "os_utils.h"
+#include "../../common/vowel_filter.h"
+#include "shm_ring.h"
+#include "shm_queue.h"
 
-void remove_vowels(char* str) {
-    if (!str) {
-        return;
+// Обрабатывает строку и записывает результат в файл. После ошибки записи
+// данные всё равно вычитываются, иначе родитель застрянет в ожидании места.
+static void filter_line(char* buffer, uint32_t len, FILE* output, StatusCode* status) {
+    len = (uint32_t) vowel_filter(buffer, len);
+    buffer[len++] = '\n';
+    if (*status == STATUS_OK && fwrite(buffer, 1, len, output) != len) {
+        perror("fwrite");
+        *status = IO_ERROR;
     }
-    int write_idx = 0;
-    for (int read_idx = 0; str[read_idx] != '\0'; read_idx++) {
-        char c = str[read_idx];
-        char lower_c = tolower((unsigned char)c);
-        if (lower_c != 'a' && lower_c != 'e' && lower_c != 'i' && 
-            lower_c != 'o' && lower_c != 'u' && lower_c != 'y') {
-            str[write_idx++] = c;
+}
+
+// Своё кольцо: за одно пробуждение разбираются все накопившиеся записи,
+// место в кольце освобождается один раз за пачку
+static StatusCode drain_ring(shm_ring_t* ring, FILE* output) {
+    char* buffer = malloc(ring->capacity + 1);
+    if (buffer == NULL) {
+        return IO_ERROR;
+    }
+    SpinPolicy spin;
+    spin_policy_init(&spin, ring->spin_us);
+    
+    StatusCode status = STATUS_OK;
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    int closed = 0;
+    while (!closed) {
+        uint32_t head = shm_wait_while(&ring->head, &ring->head_sleepers, tail, &spin);
+        
+        while (tail != head) {
+            uint32_t len;
+            ring_copy_out(ring, tail, &len, sizeof(len));
+            if (len == RING_CLOSE) {
+                closed = 1;
+                tail += RING_RECORD_SIZE(0);
+                break;
+            }
+            ring_copy_out(ring, tail + sizeof(len), buffer, len);
+            tail += RING_RECORD_SIZE(len);
+            filter_line(buffer, len, output, &status);
+        }
+        fflush(output);
+        
+        // Освобождаем место и будим родителя, если он ждёт его
+        shm_store_wake(&ring->tail, &ring->tail_sleepers, tail);
+    }
+    free(buffer);
+    return status;
+}
+
+// Общая очередь: строки берутся, пока они есть; вывод сбрасывается перед сном
+static StatusCode drain_queue(shm_queue_t* queue, int index, FILE* output) {
+    SpinPolicy spin;
+    spin_policy_init(&spin, queue->spin_us);
+    
+    StatusCode status = STATUS_OK;
+    unsigned long long processed = 0;
+    char buffer[MAX_LINE_LENGTH + 1];
+    uint32_t len;
+    for (;;) {
+        if (!queue_try_pop(queue, buffer, &len)) {
+            fflush(output);
+            if (!queue_pop(queue, buffer, &len, &spin)) {
+                break;
+            }
         }
+        filter_line(buffer, len, output, &status);
+        processed++;
     }
-    str[write_idx] = '\0';
+    fflush(output);
+    queue->processed[index] = processed;
+    return status;
 }
 
+// child <shm_name> <output_file> - своё кольцо;
+// child -q <index> <shm_name> <output_file> - общая очередь, index - номер ребёнка
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        fprintf(stderr, "Использование: %s <shm_name> <output_file>\n", argv[0]);
+    int index = -1;
+    if (argc == 5 && strcmp(argv[1], "-q") == 0) {
+        index = atoi(argv[2]);
+        if (index < 0) {
+            index = QUEUE_MAX_CHILDREN;   // Отрицательный номер - ошибка
+        }
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc != 3 || index >= QUEUE_MAX_CHILDREN) {
+        fprintf(stderr, "Использование: %s [-q index] <shm_name> <output_file>\n", argv[0]);
         return INVALID_INPUT;
     }
     
@@ -32,9 +102,18 @@ int main(int argc, char* argv[]) {
         return MMAP_ERROR;
     }
     
+    // Размер сегмента задаёт родитель: берём его у объекта
+    size_t header_size = index >= 0 ? sizeof(shm_queue_t) : sizeof(shm_ring_t);
+    struct stat st;
+    if (fstat(shm_fd, &st) == -1 || (size_t) st.st_size < header_size) {
+        perror("fstat");
+        close(shm_fd);
+        return MMAP_ERROR;
+    }
+    size_t segment_size = (size_t) st.st_size;
+    
     // Отображение разделяемой памяти
-    shared_data_t* shared = mmap(NULL, sizeof(shared_data_t), 
-                                PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    void* shared = mmap(NULL, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
     if (shared == MAP_FAILED) {
         perror("mmap");
         close(shm_fd);
@@ -45,51 +124,23 @@ int main(int argc, char* argv[]) {
     FILE* output = fopen(output_name, "w");
     if (output == NULL) {
         perror("fopen");
-        munmap(shared, sizeof(shared_data_t));
+        munmap(shared, segment_size);
         close(shm_fd);
         return FILE_OPEN_ERROR;
     }
     
     printf("Дочерний процесс начал работу (SHM: %s, Output: %s)\n", shm_name, output_name);
     
-    // Основной цикл обработки
-    while (1) {
-        if (shared->process_complete) {
-            break;
-        }
-        
-        if (shared->data_ready) {
-            // Копируем данные для обработки
-            char buffer[MAX_LINE_LENGTH];
-            strncpy(buffer, shared->data, MAX_LINE_LENGTH - 1);
-            buffer[MAX_LINE_LENGTH - 1] = '\0';
-            
-            // Обрабатываем строку
-            remove_vowels(buffer);
-            
-            // Записываем результат в файл
-            if (fprintf(output, "%s\n", buffer) < 0) {
-                perror("fprintf");
-                fclose(output);
-                munmap(shared, sizeof(shared_data_t));
-                close(shm_fd);
-                return IO_ERROR;
-            }
-            fflush(output);
-            
-            // Сбрасываем флаг готовности данных
-            shared->data_ready = 0;
-        }
-        
-        // usleep(1000); // Небольшая пауза для уменьшения нагрузки на CPU
-    }
+    StatusCode status = index >= 0 ? drain_queue(shared, index, output) : drain_ring(shared, output);
     
     printf("Дочерний процесс завершил работу\n");
     
     // Освобождение ресурсов
-    fclose(output);
-    munmap(shared, sizeof(shared_data_t)); // удаление отображения
+    if (fclose(output) != 0 && status == STATUS_OK) {
+        status = IO_ERROR;
+    }
+    munmap(shared, segment_size); // удаление отображения
     close(shm_fd);
     
-    return STATUS_OK;
+    return status;
 }
\ No newline at end of file
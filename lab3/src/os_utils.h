@@ -12,10 +12,16 @@
 #include <errno.h>
 #include <time.h>
 #include <ctype.h>
+#include <stdatomic.h>
+#include <stdint.h>
 
 #define MAX_LINE_LENGTH 1024
 #define SHARED_MEM_SIZE 4096
 #define MAX_FILENAME_LENGTH 256
+#define SHM_SPIN_US 50          // Предел вращения перед сном в futex по умолчанию, мкс
+#define SHM_RING_SIZE (64 * 1024)   // Ёмкость кольца по умолчанию, байт
+#define SHM_CACHE_LINE 64
+#define QUEUE_MAX_CHILDREN 64
 
 typedef enum {
     STATUS_OK = 0,
@@ -27,13 +33,42 @@ typedef enum {
     IO_ERROR = 6
 } StatusCode;
 
-// Структура для разделяемой памяти
+// Структура для разделяемой памяти: кольцо записей переменной длины
+// (операции в shm_ring.h). head пишет только родитель, tail - только ребёнок;
+// они на разных строках кэша, чтобы записи одной стороны не сбрасывали
+// строку кэша другой. Оба счётчика - слова futex.
 typedef struct {
+    _Alignas(SHM_CACHE_LINE) _Atomic uint32_t head;   // Байт записано (по модулю 2^32)
+    _Atomic uint32_t head_sleepers;                   // Ребёнок спит на head
+    _Alignas(SHM_CACHE_LINE) _Atomic uint32_t tail;   // Байт прочитано
+    _Atomic uint32_t tail_sleepers;                   // Родитель спит на tail
+    _Alignas(SHM_CACHE_LINE) uint32_t capacity;       // Размер data, степень двойки
+    uint32_t spin_us;            // Предел вращения перед сном (0 - сразу спать)
+    _Alignas(SHM_CACHE_LINE) char data[];
+} shm_ring_t;
+
+// Общая очередь для N детей (операции в shm_queue.h): ограниченное кольцо
+// ячеек с номерами последовательности. Ячейка pos свободна для записи, когда
+// её sequence == pos, и готова к чтению, когда sequence == pos + 1.
+typedef struct {
+    _Alignas(SHM_CACHE_LINE) _Atomic uint32_t sequence;
+    uint32_t len;
     char data[MAX_LINE_LENGTH];
-    int data_ready;        // Флаг наличия данных
-    int process_complete;  // Флаг завершения процесса
-} shared_data_t;
+} queue_slot_t;
 
-void remove_vowels(char* str);
+typedef struct {
+    _Alignas(SHM_CACHE_LINE) _Atomic uint32_t enqueue_pos;   // Следующая ячейка для записи
+    _Alignas(SHM_CACHE_LINE) _Atomic uint32_t dequeue_pos;   // Следующая ячейка для чтения
+    _Alignas(SHM_CACHE_LINE) _Atomic uint32_t produced;      // Слово futex: растёт с каждой записью
+    _Atomic uint32_t consumer_sleepers;
+    _Alignas(SHM_CACHE_LINE) _Atomic uint32_t consumed;      // Слово futex: растёт с каждым чтением
+    _Atomic uint32_t producer_sleepers;
+    _Alignas(SHM_CACHE_LINE) uint32_t mask;                  // Число ячеек - 1, ячеек степень двойки
+    uint32_t spin_us;
+    _Atomic uint32_t closed;                                 // Записей больше не будет
+    // Каждый ребёнок пишет свой счётчик один раз, при выходе
+    unsigned long long processed[QUEUE_MAX_CHILDREN];
+    queue_slot_t slots[];
+} shm_queue_t;
 
 #endif
\ No newline at end of file
@@ -1,13 +1,15 @@
 #include "os_utils.h"
+#include "shm_ring.h"
+#include "shm_queue.h"
 
-int create_shared_memory(const char* name) {
+int create_shared_memory(const char* name, size_t size) {
     int fd = shm_open(name, O_CREAT | O_RDWR, 0666);
     if (fd == -1) {
         perror("shm_open");
         return -1;
     }
     
-    if (ftruncate(fd, sizeof(shared_data_t)) == -1) {
+    if (ftruncate(fd, size) == -1) {
         perror("ftruncate");
         close(fd);
         return -1;
@@ -16,18 +18,174 @@ int create_shared_memory(const char* name) {
     return fd;
 }
 
-int main() {
+// Общая очередь: один сегмент, N детей разбирают строки по мере готовности
+static int run_shared_queue(int children, unsigned spin_us, unsigned long queue_bytes) {
+    char shm_name[MAX_FILENAME_LENGTH];
+    char (*output_names)[MAX_FILENAME_LENGTH] = calloc(children, MAX_FILENAME_LENGTH);
+    pid_t* pids = calloc(children, sizeof(pid_t));
+    if (output_names == NULL || pids == NULL) {
+        free(output_names);
+        free(pids);
+        return MMAP_ERROR;
+    }
+    
+    StatusCode status = STATUS_OK;
+    
+    printf("Введите имя shared memory для очереди: ");
+    if (fgets(shm_name, sizeof(shm_name), stdin) == NULL) {
+        status = INVALID_INPUT;
+    }
+    shm_name[strcspn(shm_name, "\n")] = '\0';
+    for (int i = 0; i < children && status == STATUS_OK; i++) {
+        printf("Введите имя файла вывода для child%d: ", i + 1);
+        if (fgets(output_names[i], MAX_FILENAME_LENGTH, stdin) == NULL) {
+            status = INVALID_INPUT;
+        }
+        output_names[i][strcspn(output_names[i], "\n")] = '\0';
+    }
+    if (status != STATUS_OK) {
+        free(output_names);
+        free(pids);
+        return status;
+    }
+    
+    // Число ячеек - степень двойки, не меньше двух
+    uint32_t slots = 2;
+    while ((unsigned long) slots * sizeof(queue_slot_t) < queue_bytes) {
+        slots *= 2;
+    }
+    size_t segment_size = queue_segment_size(slots);
+    
+    int shm_fd = create_shared_memory(shm_name, segment_size);
+    if (shm_fd == -1) {
+        free(output_names);
+        free(pids);
+        return MMAP_ERROR;
+    }
+    shm_queue_t* queue = mmap(NULL, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if (queue == MAP_FAILED) {
+        perror("mmap");
+        close(shm_fd);
+        shm_unlink(shm_name);
+        free(output_names);
+        free(pids);
+        return MMAP_ERROR;
+    }
+    queue_init(queue, slots, spin_us);
+    SpinPolicy spin;
+    spin_policy_init(&spin, spin_us);
+    
+    int started = 0;
+    for (; started < children; started++) {
+        pids[started] = fork();
+        if (pids[started] == -1) {
+            perror("fork");
+            status = FORK_ERROR;
+            break;
+        }
+        if (pids[started] == 0) {
+            char index[16];
+            snprintf(index, sizeof(index), "%d", started);
+            execl("./child", "child", "-q", index, shm_name, output_names[started], NULL);
+            perror("execl");
+            exit(3);  // EXEC_ERROR = 3
+        }
+    }
+    
+    if (status == STATUS_OK) {
+        printf("Родительский процесс начался\n");
+        printf("Введите строки (для выхода введите QUIT):\n");
+        
+        char buffer[MAX_LINE_LENGTH];
+        while (fgets(buffer, sizeof(buffer), stdin) != NULL) {
+            int len = strlen(buffer);
+            if (len > 0 && buffer[len - 1] == '\n') {
+                buffer[len - 1] = '\0';
+                len--;
+            }
+            
+            if (strcmp(buffer, "QUIT") == 0) {
+                break;
+            }
+            
+            // Строку возьмёт первый освободившийся ребёнок
+            queue_push(queue, buffer, (uint32_t) len, &spin);
+        }
+    }
+    
+    // Сигнал дочерним процессам о завершении
+    queue_close(queue);
+    
+    // Ожидание завершения и отчёт о том, сколько строк обработал каждый
+    unsigned long long total = 0;
+    for (int i = 0; i < started; i++) {
+        waitpid(pids[i], NULL, 0);
+        total += queue->processed[i];
+    }
+    for (int i = 0; i < started; i++) {
+        printf("Child%d (%s): обработано %llu строк (%.1f%%)\n", i + 1, output_names[i], queue->processed[i],
+               total ? 100.0 * queue->processed[i] / total : 0.0);
+    }
+    if (status == STATUS_OK) {
+        printf("Родительский и дочерние процессы успешно завершены\n");
+    }
+    
+    munmap(queue, segment_size);
+    close(shm_fd);
+    shm_unlink(shm_name);
+    free(output_names);
+    free(pids);
+    return status;
+}
+
+// ./parent [-s spin_us] [-r ring_bytes] [-n children]
+//   -s - сколько микросекунд ждать вращением перед сном в futex;
+//   -r - ёмкость кольца каждого ребёнка (округляется вверх до степени двойки),
+//        с -n - размер общей очереди;
+//   -n - вместо двух колец 80/20 одна общая очередь на children детей
+int main(int argc, char* argv[]) {
     char shm_name1[MAX_FILENAME_LENGTH];
     char shm_name2[MAX_FILENAME_LENGTH];
     char output_name1[MAX_FILENAME_LENGTH];
     char output_name2[MAX_FILENAME_LENGTH];
     
-    shared_data_t *shared1, *shared2;
+    shm_ring_t *shared1, *shared2;
     int shm_fd1, shm_fd2;
     pid_t pid1, pid2;
     
     StatusCode status = STATUS_OK;
     
+    unsigned spin_us = SHM_SPIN_US;
+    unsigned long ring_bytes = SHM_RING_SIZE;
+    int children = 0;
+    int bad_usage = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:n:")) != -1) {
+        if (opt == 's' && strspn(optarg, "0123456789") == strlen(optarg) && strlen(optarg) < 9) {
+            spin_us = (unsigned) strtoul(optarg, NULL, 10);
+        } else if (opt == 'r' && (ring_bytes = strtoul(optarg, NULL, 10)) >= 64 && ring_bytes <= (1ul << 30)) {
+            continue;
+        } else if (opt == 'n' && (children = atoi(optarg)) > 0 && children <= QUEUE_MAX_CHILDREN) {
+            continue;
+        } else {
+            bad_usage = 1;
+        }
+    }
+    if (bad_usage || optind != argc) {
+        fprintf(stderr, "Использование: %s [-s spin_us] [-r ring_bytes] [-n children]\n", argv[0]);
+        return INVALID_INPUT;
+    }
+    if (children > 0) {
+        return run_shared_queue(children, spin_us, ring_bytes);
+    }
+    // Позиция в кольце - счётчик по модулю ёмкости, поэтому ёмкость - степень двойки;
+    // в кольцо должна помещаться хотя бы одна самая длинная строка
+    uint32_t capacity = 64;
+    while (capacity < ring_bytes || capacity < RING_RECORD_SIZE(MAX_LINE_LENGTH)) {
+        capacity *= 2;
+    }
+    size_t segment_size = ring_segment_size(capacity);
+    
     srand(time(NULL));
     
     // Ввод имен для разделяемой памяти и выходных файлов
@@ -56,16 +214,16 @@ int main() {
     output_name2[strcspn(output_name2, "\n")] = '\0';
     
     // Создание разделяемой памяти
-    shm_fd1 = create_shared_memory(shm_name1);
-    shm_fd2 = create_shared_memory(shm_name2);
+    shm_fd1 = create_shared_memory(shm_name1, segment_size);
+    shm_fd2 = create_shared_memory(shm_name2, segment_size);
     
     if (shm_fd1 == -1 || shm_fd2 == -1) {
         return MMAP_ERROR;
     }
     
     // Отображение разделяемой памяти
-    shared1 = mmap(NULL, sizeof(shared_data_t), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd1, 0);
-    shared2 = mmap(NULL, sizeof(shared_data_t), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd2, 0);
+    shared1 = mmap(NULL, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd1, 0);
+    shared2 = mmap(NULL, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd2, 0);
     
     if (shared1 == MAP_FAILED || shared2 == MAP_FAILED) {
         perror("mmap");
@@ -73,8 +231,14 @@ int main() {
     }
     
     // Инициализация разделяемой памяти
-    memset(shared1, 0, sizeof(shared_data_t));
-    memset(shared2, 0, sizeof(shared_data_t));
+    memset(shared1, 0, sizeof(shm_ring_t));
+    memset(shared2, 0, sizeof(shm_ring_t));
+    shared1->capacity = capacity;
+    shared2->capacity = capacity;
+    shared1->spin_us = spin_us;
+    shared2->spin_us = spin_us;
+    SpinPolicy spin;
+    spin_policy_init(&spin, spin_us);
     
     // Создание первого дочернего процесса
     pid1 = fork();
@@ -123,7 +287,7 @@ int main() {
         
         // Вероятностная отправка (80% - child1, 20% - child2)
         int random_percent = rand() % 100;
-        shared_data_t* target_shared;
+        shm_ring_t* target_shared;
         const char* target_name;
         
         if (random_percent < 80) {
@@ -136,19 +300,15 @@ int main() {
         
         printf("Отправлено в %s (вероятность: %d%%)\n", target_name, random_percent);
         
-        // Копирование данных в разделяемую память
-        strncpy(target_shared->data, buffer, MAX_LINE_LENGTH - 1);
-        target_shared->data_ready = 1; // поднимает флаг "данные готовы"
-        
-        // Ожидание обработки дочерним процессом
-        while (target_shared->data_ready == 1) {
-            // usleep(1000); // Небольшая пауза
+        // Запись в кольцо: ждать приходится, только если ребёнок отстал на всё кольцо
+        if (ring_push(target_shared, buffer, (uint32_t) len, &spin) == -1) {
+            fprintf(stderr, "Строка длиннее кольца\n");
         }
     }
     
     // Сигнал дочерним процессам о завершении
-    shared1->process_complete = 1;
-    shared2->process_complete = 1;
+    ring_close(shared1, &spin);
+    ring_close(shared2, &spin);
     
     // Ожидание завершения дочерних процессов
     waitpid(pid1, NULL, 0);
@@ -158,8 +318,8 @@ int main() {
 
 cleanup:
     // Освобождение ресурсов
-    if (shared1 != MAP_FAILED) munmap(shared1, sizeof(shared_data_t));
-    if (shared2 != MAP_FAILED) munmap(shared2, sizeof(shared_data_t));
+    if (shared1 != MAP_FAILED) munmap(shared1, segment_size);
+    if (shared2 != MAP_FAILED) munmap(shared2, segment_size);
     if (shm_fd1 != -1) {
         close(shm_fd1);
         shm_unlink(shm_name1); // удаление объекта
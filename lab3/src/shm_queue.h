@@ -0,0 +1,126 @@
+#ifndef SHM_QUEUE_H
+#define SHM_QUEUE_H
+
+#include "os_utils.h"
+#include "shm_sync.h"
+
+// Операции очереди shm_queue_t (см. os_utils.h) - ограниченная очередь
+// со многими писателями и читателями без блокировок (схема Вьюкова).
+// Позицию захватывают CAS на enqueue_pos/dequeue_pos, а готовность ячейки
+// публикуется её sequence с release: захвативший ячейку не мешает остальным.
+// Ожидание пустой или полной очереди - на счётчиках produced/consumed
+// (вращение, затем futex), чтобы не крутиться на позициях.
+
+static inline size_t queue_segment_size(uint32_t slots) {
+    return sizeof(shm_queue_t) + sizeof(queue_slot_t) * slots;
+}
+
+static inline void queue_init(shm_queue_t* queue, uint32_t slots, unsigned spin_us) {
+    memset(queue, 0, sizeof(shm_queue_t));
+    queue->mask = slots - 1;
+    queue->spin_us = spin_us;
+    for (uint32_t i = 0; i < slots; i++) {
+        atomic_store_explicit(&queue->slots[i].sequence, i, memory_order_relaxed);
+    }
+}
+
+// Счётчик растёт на единицу; спящих будим по одному - на одну запись хватит одного
+static inline void queue_signal(_Atomic uint32_t* counter, _Atomic uint32_t* sleepers) {
+    atomic_fetch_add(counter, 1);
+    if (atomic_load(sleepers) > 0) {
+        futex_wake(counter, 1);
+    }
+}
+
+// 0 - очередь полна
+static inline int queue_try_push(shm_queue_t* queue, const char* line, uint32_t len) {
+    uint32_t pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+    queue_slot_t* slot;
+    for (;;) {
+        slot = &queue->slots[pos & queue->mask];
+        uint32_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int32_t diff = (int32_t) (seq - pos);
+        if (diff == 0) {
+            // Ячейка свободна: захватываем позицию (при неудаче pos обновится)
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Ячейку ещё не освободили с прошлого круга
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+        }
+    }
+    memcpy(slot->data, line, len);
+    slot->len = len;
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    queue_signal(&queue->produced, &queue->consumer_sleepers);
+    return 1;
+}
+
+// 0 - очередь пуста (или ближайшая запись ещё не опубликована)
+static inline int queue_try_pop(shm_queue_t* queue, char* buffer, uint32_t* len) {
+    uint32_t pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+    queue_slot_t* slot;
+    for (;;) {
+        slot = &queue->slots[pos & queue->mask];
+        uint32_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int32_t diff = (int32_t) (seq - (pos + 1));
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+        }
+    }
+    *len = slot->len;
+    memcpy(buffer, slot->data, slot->len);
+    // Ячейка освобождается для записи на следующем круге
+    atomic_store_explicit(&slot->sequence, pos + queue->mask + 1, memory_order_release);
+    queue_signal(&queue->consumed, &queue->producer_sleepers);
+    return 1;
+}
+
+// Счётчик читается до попытки: запись, опубликованная после неудачи,
+// обязательно его изменит, и ожидание не пропустит пробуждение
+static inline void queue_push(shm_queue_t* queue, const char* line, uint32_t len, SpinPolicy* spin) {
+    for (;;) {
+        uint32_t observed = atomic_load(&queue->consumed);
+        if (queue_try_push(queue, line, len)) {
+            return;
+        }
+        shm_wait_while(&queue->consumed, &queue->producer_sleepers, observed, spin);
+    }
+}
+
+// 1 - запись получена, 0 - очередь закрыта и пуста
+static inline int queue_pop(shm_queue_t* queue, char* buffer, uint32_t* len, SpinPolicy* spin) {
+    for (;;) {
+        uint32_t observed = atomic_load(&queue->produced);
+        // closed читается до попытки: закрытие идёт после всех записей,
+        // поэтому неудача после закрытия значит, что записей не осталось
+        int closed = atomic_load(&queue->closed);
+        if (queue_try_pop(queue, buffer, len)) {
+            return 1;
+        }
+        if (closed) {
+            return 0;
+        }
+        shm_wait_while(&queue->produced, &queue->consumer_sleepers, observed, spin);
+    }
+}
+
+// Вызывается после всех queue_push; будит всех ожидающих читателей
+static inline void queue_close(shm_queue_t* queue) {
+    atomic_store(&queue->closed, 1);
+    atomic_fetch_add(&queue->produced, 1);
+    futex_wake(&queue->produced, INT_MAX);
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include "os_utils.h"
+#include "shm_sync.h"
+
+// Операции кольца shm_ring_t (см. os_utils.h). Один производитель (родитель)
+// и один потребитель (ребёнок): каждый счётчик пишет только своя сторона,
+// поэтому достаточно загрузок acquire и сохранений release без блокировок.
+//
+// Запись: uint32 длина, затем байты строки, выровненные до 4. Заголовок
+// никогда не разрезается концом кольца (ёмкость кратна 4), а байты строки
+// могут переходить через конец. Длина RING_CLOSE - конец потока.
+
+#define RING_CLOSE UINT32_MAX
+#define RING_RECORD_SIZE(len) ((uint32_t) sizeof(uint32_t) + (((uint32_t) (len) + 3) & ~3u))
+
+static inline size_t ring_segment_size(uint32_t capacity) {
+    return sizeof(shm_ring_t) + capacity;
+}
+
+// Копирование с учётом перехода через конец кольца
+static inline void ring_copy_in(shm_ring_t* ring, uint32_t pos, const void* src, uint32_t len) {
+    uint32_t offset = pos & (ring->capacity - 1);
+    uint32_t first = ring->capacity - offset;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(ring->data + offset, src, first);
+    memcpy(ring->data, (const char*) src + first, len - first);
+}
+
+static inline void ring_copy_out(const shm_ring_t* ring, uint32_t pos, void* dst, uint32_t len) {
+    uint32_t offset = pos & (ring->capacity - 1);
+    uint32_t first = ring->capacity - offset;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(dst, ring->data + offset, first);
+    memcpy((char*) dst + first, ring->data, len - first);
+}
+
+// Добавляет запись, ожидая места; -1 - запись больше кольца
+static inline int ring_push(shm_ring_t* ring, const char* line, uint32_t len, SpinPolicy* spin) {
+    uint32_t need = RING_RECORD_SIZE(len == RING_CLOSE ? 0 : len);
+    if (need > ring->capacity) {
+        return -1;
+    }
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    // Счётчики идут по модулю 2^32: head - tail - занятые байты
+    while (ring->capacity - (head - tail) < need) {
+        tail = shm_wait_while(&ring->tail, &ring->tail_sleepers, tail, spin);
+    }
+    ring_copy_in(ring, head, &len, sizeof(len));
+    if (len != RING_CLOSE) {
+        ring_copy_in(ring, head + sizeof(len), line, len);
+    }
+    shm_store_wake(&ring->head, &ring->head_sleepers, head + need);
+    return 0;
+}
+
+static inline void ring_close(shm_ring_t* ring, SpinPolicy* spin) {
+    ring_push(ring, NULL, RING_CLOSE, spin);
+}
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef SHM_SYNC_H
+#define SHM_SYNC_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+// Ожидание смены слова в разделяемой памяти: сначала короткое вращение
+// (пробуждение за доли микросекунды, пока другой процесс быстро отвечает),
+// затем сон в futex, чтобы простаивающий процесс не занимал ядро.
+// Слово лежит в MAP_SHARED памяти, поэтому futex без FUTEX_PRIVATE_FLAG.
+
+static inline void shm_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static inline uint64_t shm_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static inline void futex_wait(_Atomic uint32_t* word, uint32_t expected) {
+    // Ядро само сверит значение: если слово уже сменилось, вызов вернётся сразу
+    syscall(SYS_futex, word, FUTEX_WAIT, expected, NULL, NULL, 0);
+}
+
+// count - сколько ожидающих будить (INT_MAX - всех)
+static inline void futex_wake(_Atomic uint32_t* word, int count) {
+    syscall(SYS_futex, word, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+// Адаптивное вращение: бюджет следует за недавними временами ожидания.
+// Ответ приходит быстро - вращение его ловит без futex, и бюджет тянется
+// к удвоенному времени ожидания; ответа долго нет - каждый сон в futex
+// вдвое урезает бюджет, до нуля, и ожидание почти сразу уходит в сон. На одном процессоре
+// вращаться бессмысленно: другая сторона не может работать, пока мы крутимся.
+typedef struct {
+    unsigned max_us;      // Предел, заданный пользователем
+    unsigned spin_us;     // Текущий бюджет вращения
+} SpinPolicy;
+
+static inline void spin_policy_init(SpinPolicy* policy, unsigned max_us) {
+    if (sysconf(_SC_NPROCESSORS_ONLN) < 2) {
+        max_us = 0;
+    }
+    policy->max_us = max_us;
+    policy->spin_us = max_us;
+}
+
+// Ждёт, пока *word != value, и возвращает новое значение. Загрузка с acquire:
+// после возврата видно всё, что другая сторона записала до shm_store_wake.
+static inline uint32_t shm_wait_while(_Atomic uint32_t* word, _Atomic uint32_t* sleepers, uint32_t value,
+                                      SpinPolicy* policy) {
+    uint32_t current = atomic_load_explicit(word, memory_order_acquire);
+    if (current != value) {
+        return current;
+    }
+    uint64_t start = shm_now_us();
+    // При нулевом бюджете - один короткий круг проверки (128 пауз), чтобы
+    // снова заметить быстрые ответы и нарастить бюджет
+    if (policy->max_us > 0) {
+        uint64_t deadline = start + policy->spin_us;
+        for (unsigned i = 1;; i++) {
+            shm_cpu_relax();
+            current = atomic_load_explicit(word, memory_order_acquire);
+            if (current != value) {
+                break;
+            }
+            // Часы читаются не на каждом круге
+            if (i % 128 == 0 && shm_now_us() >= deadline) {
+                break;
+            }
+        }
+    }
+    if (current != value) {
+        // Вращение поймало смену: бюджет тянется к удвоенному времени ожидания
+        uint64_t target = 2 * (shm_now_us() - start);
+        if (target > policy->max_us) {
+            target = policy->max_us;
+        }
+        policy->spin_us = (unsigned) ((policy->spin_us + target) / 2);
+        return current;
+    }
+    // Счётчик спящих и слово - seq_cst с обеих сторон: либо будящий увидит
+    // спящего, либо спящий увидит новое значение до futex_wait
+    atomic_fetch_add(sleepers, 1);
+    while ((current = atomic_load(word)) == value) {
+        futex_wait(word, value);
+    }
+    atomic_fetch_sub(sleepers, 1);
+    // Пришлось спать: вращение не окупилось, бюджет вдвое меньше (до нуля)
+    policy->spin_us /= 2;
+    return current;
+}
+
+// Публикует значение (release для данных, записанных до него) и будит
+// ожидающих; без спящих системного вызова нет
+static inline void shm_store_wake(_Atomic uint32_t* word, _Atomic uint32_t* sleepers, uint32_t value) {
+    atomic_store(word, value);
+    if (atomic_load(sleepers) > 0) {
+        futex_wake(word, INT_MAX);
+    }
+}
+
+#endif